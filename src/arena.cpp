@@ -0,0 +1,101 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "arena.h"
+
+// =============================================================================
+//
+Arena::Arena() :
+	m_blocks (null),
+	m_position (null),
+	m_end (null),
+	m_destructors (null) {}
+
+// =============================================================================
+//
+Arena::~Arena()
+{
+	clear();
+}
+
+// =============================================================================
+//
+// Returns @size bytes of memory aligned to @alignment, which must be a power of
+// two no greater than that of any type. Objects larger than a block get a block
+// of their own.
+//
+void* Arena::allocate (size_t size, size_t alignment)
+{
+	char* result = (char*) (((uintptr_t) m_position + alignment - 1) & ~(uintptr_t) (alignment - 1));
+
+	if (m_position == null || result + size > m_end)
+	{
+		size_t headerSize = (sizeof (Block) + alignof (std::max_align_t) - 1) & ~(alignof (std::max_align_t) - 1);
+		size_t blockSize = max<size_t> (BlockSize, headerSize + size);
+		Block* block = reinterpret_cast<Block*> (new char[blockSize]);
+		block->next = m_blocks;
+		m_blocks = block;
+		result = reinterpret_cast<char*> (block) + headerSize;
+		m_end = reinterpret_cast<char*> (block) + blockSize;
+	}
+
+	m_position = result + size;
+	return result;
+}
+
+// =============================================================================
+//
+void Arena::addDestructor (void* object, void (*function) (void*))
+{
+	Destructor* destructor = static_cast<Destructor*> (allocate (sizeof (Destructor), alignof (Destructor)));
+	destructor->function = function;
+	destructor->object = object;
+	destructor->next = m_destructors;
+	m_destructors = destructor;
+}
+
+// =============================================================================
+//
+// Destroys every object in the arena and frees its memory.
+//
+void Arena::clear()
+{
+	for (Destructor* destructor = m_destructors; destructor != null; destructor = destructor->next)
+		destructor->function (destructor->object);
+
+	while (m_blocks != null)
+	{
+		Block* next = m_blocks->next;
+		delete[] reinterpret_cast<char*> (m_blocks);
+		m_blocks = next;
+	}
+
+	m_position = null;
+	m_end = null;
+	m_destructors = null;
+}
@@ -0,0 +1,95 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_ARENA_H
+#define BOTC_ARENA_H
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include "main.h"
+
+// =============================================================================
+//
+// A bump-pointer allocator for the objects made during a compilation. Objects
+// are never freed one at a time; the arena frees them all at once when it is
+// cleared or destroyed, running their destructors in the reverse order of
+// their construction.
+//
+class Arena
+{
+	public:
+		Arena();
+		~Arena();
+
+		void*	allocate (size_t size, size_t alignment);
+		void	clear();
+
+		// Constructs an object of type T in the arena.
+		template<typename T, typename... Args>
+		T* make (Args&&... args)
+		{
+			T* object = new (allocate (sizeof (T), alignof (T))) T (std::forward<Args> (args)...);
+
+			if (std::is_trivially_destructible<T>::value == false)
+				addDestructor (object, &destroy<T>);
+
+			return object;
+		}
+
+	private:
+		enum { BlockSize = 64 * 1024 };
+
+		struct Block
+		{
+			Block*		next;
+		};
+
+		struct Destructor
+		{
+			void		(*function) (void*);
+			void*		object;
+			Destructor*	next;
+		};
+
+		Block*			m_blocks;
+		char*			m_position;
+		char*			m_end;
+		Destructor*		m_destructors;
+
+		void			addDestructor (void* object, void (*function) (void*));
+
+		template<typename T>
+		static void destroy (void* object)
+		{
+			static_cast<T*> (object)->~T();
+		}
+};
+
+#endif // BOTC_ARENA_H
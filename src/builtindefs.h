@@ -0,0 +1,244 @@
+#ifndef BOTC_BUILTINDEFS_H
+#define BOTC_BUILTINDEFS_H
+
+#include "builtins.h"
+
+static constexpr const char* g_BuiltinDefinitionsFile = "botc_defs.bts";
+
+static constexpr BuiltinArgument g_BuiltinArguments[] =
+{
+	{ TYPE_Int, "newstate", 0 },
+	{ TYPE_Int, "tics", 0 },
+	{ TYPE_Int, "a", 0 },
+	{ TYPE_Int, "b", 0 },
+	{ TYPE_String, "string1", 0 },
+	{ TYPE_String, "string2", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Bool, "visibilitycheck", 0 },
+	{ TYPE_Int, "start", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "distance", 0 },
+	{ TYPE_Int, "angle", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "speed", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "turnangle", 0 },
+	{ TYPE_Int, "player", 0 },
+	{ TYPE_String, "weapon", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_Int, "item", 0 },
+	{ TYPE_String, "weapon", 0 },
+	{ TYPE_String, "message", 0 },
+	{ TYPE_String, "filename", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "filename", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_Bool, "increase", 0 },
+	{ TYPE_Bool, "decrease", 0 },
+	{ TYPE_Int, "player", 0 },
+	{ TYPE_Int, "script", 0 },
+	{ TYPE_Int, "map", 0 },
+	{ TYPE_Int, "arg0", 0 },
+	{ TYPE_Int, "arg1", 0 },
+	{ TYPE_Int, "arg2", 0 },
+	{ TYPE_String, "lump", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "lump", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_String, "section", 0 },
+	{ TYPE_Unknown, nullptr, 0 },
+};
+
+static constexpr BuiltinCommand g_BuiltinCommands[] =
+{
+	{ "changestate", 0, 1, TYPE_Void, 0, 1, "botc_defs.bts:11" },
+	{ "delay", 1, 1, TYPE_Void, 1, 1, "botc_defs.bts:12" },
+	{ "rand", 2, 2, TYPE_Int, 2, 2, "botc_defs.bts:13" },
+	{ "StringsAreEqual", 3, 2, TYPE_Bool, 4, 2, "botc_defs.bts:14" },
+	{ "LookForPowerups", 4, 2, TYPE_Int, 6, 2, "botc_defs.bts:15" },
+	{ "LookForWeapons", 5, 2, TYPE_Int, 8, 2, "botc_defs.bts:16" },
+	{ "LookForAmmo", 6, 2, TYPE_Int, 10, 2, "botc_defs.bts:17" },
+	{ "LookForBaseHealth", 7, 2, TYPE_Int, 12, 2, "botc_defs.bts:18" },
+	{ "LookForBaseArmor", 8, 2, TYPE_Int, 14, 2, "botc_defs.bts:19" },
+	{ "LookForSuperHealth", 9, 2, TYPE_Int, 16, 2, "botc_defs.bts:20" },
+	{ "LookForSuperArmor", 10, 2, TYPE_Int, 18, 2, "botc_defs.bts:21" },
+	{ "LookForPlayerEnemies", 11, 1, TYPE_Int, 20, 1, "botc_defs.bts:22" },
+	{ "GetClosestPlayerEnemy", 12, 0, TYPE_Int, 21, 0, "botc_defs.bts:23" },
+	{ "MoveLeft", 13, 1, TYPE_Void, 21, 1, "botc_defs.bts:24" },
+	{ "MoveRight", 14, 1, TYPE_Void, 22, 1, "botc_defs.bts:25" },
+	{ "MoveForward", 15, 1, TYPE_Void, 23, 1, "botc_defs.bts:26" },
+	{ "MoveBackwards", 16, 1, TYPE_Void, 24, 1, "botc_defs.bts:27" },
+	{ "StopMovement", 17, 0, TYPE_Void, 25, 0, "botc_defs.bts:28" },
+	{ "StopForwardMovement", 18, 0, TYPE_Void, 25, 0, "botc_defs.bts:29" },
+	{ "StopSidewaysMovement", 19, 0, TYPE_Void, 25, 0, "botc_defs.bts:30" },
+	{ "CheckTerrain", 20, 2, TYPE_Int, 25, 2, "botc_defs.bts:31" },
+	{ "PathToGoal", 21, 1, TYPE_Int, 27, 1, "botc_defs.bts:32" },
+	{ "PathToLastKnownEnemyPosition", 22, 1, TYPE_Int, 28, 1, "botc_defs.bts:33" },
+	{ "PathToLastHeardSound", 23, 1, TYPE_Int, 29, 1, "botc_defs.bts:34" },
+	{ "Roam", 24, 1, TYPE_Int, 30, 1, "botc_defs.bts:35" },
+	{ "GetPathingCostToItem", 25, 1, TYPE_Int, 31, 1, "botc_defs.bts:36" },
+	{ "GetDistanceToItem", 26, 1, TYPE_Int, 32, 1, "botc_defs.bts:37" },
+	{ "GetItemName", 27, 1, TYPE_String, 33, 1, "botc_defs.bts:38" },
+	{ "IsItemVisible", 28, 1, TYPE_Bool, 34, 1, "botc_defs.bts:39" },
+	{ "SetGoal", 29, 1, TYPE_Void, 35, 1, "botc_defs.bts:40" },
+	{ "BeginAimingAtEnemy", 30, 0, TYPE_Void, 36, 0, "botc_defs.bts:41" },
+	{ "StopAimingAtEnemy", 31, 0, TYPE_Void, 36, 0, "botc_defs.bts:42" },
+	{ "Turn", 32, 1, TYPE_Void, 36, 1, "botc_defs.bts:43" },
+	{ "GetCurrentAngle", 33, 0, TYPE_Int, 37, 0, "botc_defs.bts:44" },
+	{ "SetEnemy", 34, 1, TYPE_Void, 37, 1, "botc_defs.bts:45" },
+	{ "ClearEnemy", 35, 0, TYPE_Void, 38, 0, "botc_defs.bts:46" },
+	{ "IsEnemyAlive", 36, 0, TYPE_Bool, 38, 0, "botc_defs.bts:47" },
+	{ "IsEnemyVisible", 37, 0, TYPE_Bool, 38, 0, "botc_defs.bts:48" },
+	{ "GetDistanceToEnemy", 38, 0, TYPE_Int, 38, 0, "botc_defs.bts:49" },
+	{ "GetPlayerDamagedBy", 39, 0, TYPE_Int, 38, 0, "botc_defs.bts:50" },
+	{ "GetEnemyInvulnerabilityTicks", 40, 0, TYPE_Int, 38, 0, "botc_defs.bts:51" },
+	{ "FireWeapon", 41, 0, TYPE_Void, 38, 0, "botc_defs.bts:52" },
+	{ "BeginFiringWeapon", 42, 0, TYPE_Void, 38, 0, "botc_defs.bts:53" },
+	{ "StopFiringWeapon", 43, 0, TYPE_Void, 38, 0, "botc_defs.bts:54" },
+	{ "GetCurrentWeapon", 44, 0, TYPE_String, 38, 0, "botc_defs.bts:55" },
+	{ "ChangeWeapon", 45, 1, TYPE_Void, 38, 1, "botc_defs.bts:56" },
+	{ "GetWeaponFromItem", 46, 1, TYPE_String, 39, 1, "botc_defs.bts:57" },
+	{ "IsWeaponOwned", 47, 1, TYPE_Bool, 40, 1, "botc_defs.bts:58" },
+	{ "IsFavoriteWeapon", 48, 1, TYPE_Bool, 41, 1, "botc_defs.bts:59" },
+	{ "Say", 49, 1, TYPE_Void, 42, 1, "botc_defs.bts:60" },
+	{ "SayFromFile", 50, 2, TYPE_Void, 43, 2, "botc_defs.bts:61" },
+	{ "SayFromChatFile", 51, 1, TYPE_Void, 45, 1, "botc_defs.bts:62" },
+	{ "BeginChatting", 52, 0, TYPE_Void, 46, 0, "botc_defs.bts:63" },
+	{ "StopChatting", 53, 0, TYPE_Void, 46, 0, "botc_defs.bts:64" },
+	{ "ChatSectionExists", 54, 1, TYPE_Bool, 46, 1, "botc_defs.bts:65" },
+	{ "ChatSectionExistsInFile", 55, 2, TYPE_Bool, 47, 2, "botc_defs.bts:66" },
+	{ "GetLastChatString", 56, 0, TYPE_String, 49, 0, "botc_defs.bts:67" },
+	{ "GetLastChatPlayer", 57, 0, TYPE_String, 49, 0, "botc_defs.bts:68" },
+	{ "GetChatFrequency", 58, 0, TYPE_Int, 49, 0, "botc_defs.bts:69" },
+	{ "Jump", 59, 0, TYPE_Void, 49, 0, "botc_defs.bts:70" },
+	{ "BeginJumping", 60, 0, TYPE_Void, 49, 0, "botc_defs.bts:71" },
+	{ "StopJumping", 61, 0, TYPE_Void, 49, 0, "botc_defs.bts:72" },
+	{ "Taunt", 62, 0, TYPE_Void, 49, 0, "botc_defs.bts:73" },
+	{ "Respawn", 63, 0, TYPE_Void, 49, 0, "botc_defs.bts:74" },
+	{ "TryToJoinGame", 64, 0, TYPE_Void, 49, 0, "botc_defs.bts:75" },
+	{ "IsDead", 65, 0, TYPE_Bool, 49, 0, "botc_defs.bts:76" },
+	{ "IsSpectating", 66, 0, TYPE_Bool, 49, 0, "botc_defs.bts:77" },
+	{ "GetHealth", 67, 0, TYPE_Int, 49, 0, "botc_defs.bts:78" },
+	{ "GetArmor", 68, 0, TYPE_Int, 49, 0, "botc_defs.bts:79" },
+	{ "GetBaseHealth", 69, 0, TYPE_Int, 49, 0, "botc_defs.bts:80" },
+	{ "GetBaseArmor", 70, 0, TYPE_Int, 49, 0, "botc_defs.bts:81" },
+	{ "GetBotskill", 71, 0, TYPE_Int, 49, 0, "botc_defs.bts:82" },
+	{ "GetAccuracy", 72, 0, TYPE_Int, 49, 0, "botc_defs.bts:83" },
+	{ "GetIntellect", 73, 0, TYPE_Int, 49, 0, "botc_defs.bts:84" },
+	{ "GetAnticipation", 74, 0, TYPE_Int, 49, 0, "botc_defs.bts:85" },
+	{ "GetEvade", 75, 0, TYPE_Int, 49, 0, "botc_defs.bts:86" },
+	{ "GetReactionTime", 76, 0, TYPE_Int, 49, 0, "botc_defs.bts:87" },
+	{ "GetPerception", 77, 0, TYPE_Int, 49, 0, "botc_defs.bts:88" },
+	{ "SetSkillIncrease", 78, 1, TYPE_Void, 49, 1, "botc_defs.bts:89" },
+	{ "IsSkillIncreased", 79, 0, TYPE_Bool, 50, 0, "botc_defs.bts:90" },
+	{ "SetSkillDecrease", 80, 1, TYPE_Void, 50, 1, "botc_defs.bts:91" },
+	{ "IsSkillDecreased", 81, 0, TYPE_Bool, 51, 0, "botc_defs.bts:92" },
+	{ "GetGameMode", 82, 0, TYPE_Int, 51, 0, "botc_defs.bts:93" },
+	{ "GetSpread", 83, 0, TYPE_Int, 51, 0, "botc_defs.bts:94" },
+	{ "GetLastJoinedPlayer", 84, 0, TYPE_String, 51, 0, "botc_defs.bts:95" },
+	{ "GetPlayerName", 85, 1, TYPE_String, 51, 1, "botc_defs.bts:96" },
+	{ "GetReceivedMedal", 86, 0, TYPE_Int, 52, 0, "botc_defs.bts:97" },
+	{ "ACS_Execute", 87, 1, TYPE_Void, 52, 5, "botc_defs.bts:98" },
+	{ "GetFavoriteWeapon", 88, 0, TYPE_String, 57, 0, "botc_defs.bts:99" },
+	{ "SayFromLump", 89, 2, TYPE_Void, 57, 2, "botc_defs.bts:100" },
+	{ "SayFromChatLump", 90, 1, TYPE_Void, 59, 1, "botc_defs.bts:101" },
+	{ "ChatSectionExistsInLump", 91, 2, TYPE_Bool, 60, 2, "botc_defs.bts:102" },
+	{ "ChatSectionExistsInChatLump", 92, 1, TYPE_Bool, 62, 1, "botc_defs.bts:103" },
+	{ nullptr, 0, 0, TYPE_Unknown, 0, 0, nullptr },
+};
+
+static constexpr BuiltinEvent g_BuiltinEvents[] =
+{
+	{ "KilledByEnemy", 0 },
+	{ "KilledByPlayer", 1 },
+	{ "KilledBySelf", 2 },
+	{ "KilledByEnvironment", 3 },
+	{ "ReachedGoal", 4 },
+	{ "GoalRemoved", 5 },
+	{ "DamagedByPlayer", 6 },
+	{ "PlayerSay", 7 },
+	{ "EnemyKilled", 8 },
+	{ "Respawned", 9 },
+	{ "Intermission", 10 },
+	{ "NewMap", 11 },
+	{ "EnemyUsedFist", 12 },
+	{ "EnemyUsedChainsaw", 13 },
+	{ "EnemyFiredPistol", 14 },
+	{ "EnemyFiredShotgun", 15 },
+	{ "EnemyFiredSSG", 16 },
+	{ "EnemyFiredChaingun", 17 },
+	{ "EnemyFiredMinigun", 18 },
+	{ "EnemyFiredRocket", 19 },
+	{ "EnemyFiredGrenade", 20 },
+	{ "EnemyFiredRailgun", 21 },
+	{ "EnemyFiredPlasma", 22 },
+	{ "EnemyFiredBFG", 23 },
+	{ "EnemyFiredBFG10k", 24 },
+	{ "PlayerUsedFist", 25 },
+	{ "PlayerUsedChainsaw", 26 },
+	{ "PlayerFiredPistol", 27 },
+	{ "PlayerFiredShotgun", 28 },
+	{ "PlayerFiredSSG", 29 },
+	{ "PlayerFiredChaingun", 30 },
+	{ "PlayerFiredMinigun", 31 },
+	{ "PlayerFiredRocket", 32 },
+	{ "PlayerFiredGrenade", 33 },
+	{ "PlayerFiredRailgun", 34 },
+	{ "PlayerFiredPlasma", 35 },
+	{ "PlayerFiredBFG", 36 },
+	{ "PlayerFiredBFG10k", 37 },
+	{ "UsedFist", 38 },
+	{ "UsedChainsaw", 39 },
+	{ "FiredPistol", 40 },
+	{ "FiredShotgun", 41 },
+	{ "FiredSSG", 42 },
+	{ "FiredChaingun", 43 },
+	{ "FiredMinigun", 44 },
+	{ "FiredRocket", 45 },
+	{ "FiredGrenade", 46 },
+	{ "FiredRailgun", 47 },
+	{ "FiredPlasma", 48 },
+	{ "FiredBFG", 49 },
+	{ "FiredBFG10k", 50 },
+	{ "PlayerJoinedGame", 51 },
+	{ "JoinedGame", 52 },
+	{ "DuelStartingCountdown", 53 },
+	{ "DuelFight", 54 },
+	{ "DuelWinSequence", 55 },
+	{ "Spectating", 56 },
+	{ "LMSStartingCountdown", 57 },
+	{ "LMSFight", 58 },
+	{ "LMSWinSequence", 59 },
+	{ "WeaponChange", 60 },
+	{ "EnemyBFGExplode", 61 },
+	{ "PlayerBFGExplode", 62 },
+	{ "BFGExplode", 63 },
+	{ "ReceivedMedal", 64 },
+	{ nullptr, 0 },
+};
+
+#endif // BOTC_BUILTINDEFS_H
@@ -0,0 +1,150 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "builtins.h"
+#include "commands.h"
+#include "events.h"
+#include "compilerContext.h"
+#include "enumstrings.h"
+
+// The bootstrap build generates the tables, so it has to do without them.
+#ifdef BOTC_BOOTSTRAP
+static constexpr const char* g_BuiltinDefinitionsFile = "botc_defs.bts";
+static constexpr BuiltinArgument g_BuiltinArguments[] = { { TYPE_Unknown, nullptr, 0 } };
+static constexpr BuiltinCommand g_BuiltinCommands[] = { { nullptr, 0, 0, TYPE_Unknown, 0, 0, nullptr } };
+static constexpr BuiltinEvent g_BuiltinEvents[] = { { nullptr, 0 } };
+#else
+#include "builtindefs.h"
+#endif
+
+// =============================================================================
+//
+// Defines the commands and events of the definitions file that botc was built
+// with to @context, in the order they are in the file. Scripts can still define
+// more of their own.
+//
+void preloadBuiltinDefinitions (CompilerContext* context)
+{
+	for (const BuiltinCommand* builtin = &g_BuiltinCommands[0]; builtin->name != null; ++builtin)
+	{
+		CommandInfo* comm = context->arena().make<CommandInfo>();
+		comm->name = builtin->name;
+		comm->number = builtin->number;
+		comm->minargs = builtin->minargs;
+		comm->returnvalue = builtin->returnvalue;
+		comm->origin = builtin->origin;
+
+		for (int i = 0; i < builtin->numargs; ++i)
+		{
+			const BuiltinArgument& builtinArg = g_BuiltinArguments[builtin->firstarg + i];
+			CommandArgument arg;
+			arg.type = builtinArg.type;
+			arg.name = builtinArg.name;
+			arg.defvalue = builtinArg.defvalue;
+			comm->args << arg;
+		}
+
+		context->addCommandDefinition (comm);
+	}
+
+	for (const BuiltinEvent* builtin = &g_BuiltinEvents[0]; builtin->name != null; ++builtin)
+	{
+		EventDefinition* e = context->arena().make<EventDefinition>();
+		e->name = builtin->name;
+		e->number = builtin->number;
+		context->addEvent (e);
+	}
+}
+
+// =============================================================================
+//
+// Returns the name of the definitions file, which scripts #include to get the
+// definitions that are built in.
+//
+const char* builtinDefinitionsFile()
+{
+	return g_BuiltinDefinitionsFile;
+}
+
+// =============================================================================
+//
+// Writes the commands and events defined to @context, as they were parsed from
+// the definitions file @fileName, into @outfile as tables for botc to be built
+// with. Each of the tables ends with an entry with a null name, so that none of
+// them is ever empty.
+//
+void writeBuiltinDefinitions (CompilerContext* context, const String& fileName,
+	const String& outfile)
+{
+	String text = "#ifndef BOTC_BUILTINDEFS_H\n#define BOTC_BUILTINDEFS_H\n\n";
+	text += "#include \"builtins.h\"\n";
+	text += format ("\nstatic constexpr const char* g_BuiltinDefinitionsFile = \"%1\";\n",
+		fileName.mid (fileName.lastIndexOf ("/") + 1));
+	text += "\nstatic constexpr BuiltinArgument g_BuiltinArguments[] =\n{\n";
+
+	for (CommandInfo* comm : context->commands())
+	{
+		for (const CommandArgument& arg : comm->args)
+		{
+			text += format ("\t{ %1, \"%2\", %3 },\n", getDataTypeString (arg.type), arg.name,
+				arg.defvalue);
+		}
+	}
+
+	text += "\t{ TYPE_Unknown, nullptr, 0 },\n};\n";
+	text += "\nstatic constexpr BuiltinCommand g_BuiltinCommands[] =\n{\n";
+	int firstarg = 0;
+
+	for (CommandInfo* comm : context->commands())
+	{
+		text += format ("\t{ \"%1\", %2, %3, %4, %5, %6, \"%7\" },\n", comm->name, comm->number,
+			comm->minargs, getDataTypeString (comm->returnvalue), firstarg, comm->args.size(),
+			comm->origin);
+		firstarg += comm->args.size();
+	}
+
+	text += "\t{ nullptr, 0, 0, TYPE_Unknown, 0, 0, nullptr },\n};\n";
+	text += "\nstatic constexpr BuiltinEvent g_BuiltinEvents[] =\n{\n";
+
+	for (EventDefinition* e : context->events())
+		text += format ("\t{ \"%1\", %2 },\n", e->name, e->number);
+
+	text += "\t{ nullptr, 0 },\n};\n\n#endif // BOTC_BUILTINDEFS_H\n";
+	FILE* fp = fopen (outfile, "w");
+
+	if (fp == null)
+		error ("couldn't open %1 for writing: %2", outfile, strerror (errno));
+
+	bool isWritten = fwrite (text.chars(), 1, text.length(), fp) == (size_t) text.length();
+
+	if (fclose (fp) != 0 || isWritten == false)
+		error ("couldn't write %1: %2", outfile, strerror (errno));
+
+	print ("Wrote %1 commands and %2 events to %3\n", context->commands().size(),
+		context->events().size(), outfile);
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_BUILTINS_H
+#define BOTC_BUILTINS_H
+
+#include "main.h"
+
+class CompilerContext;
+
+// =============================================================================
+//
+// The commands and events of botc_defs.bts are compiled into botc as tables.
+// They are generated into builtindefs.h when botc is built, by a bootstrap
+// build of botc that parses the file and writes out what its parser defined
+// (see writeBuiltinDefinitions). With --builtin-defs, they are defined from
+// these tables and scripts don't need the file anymore.
+//
+struct BuiltinArgument
+{
+	DataType		type;
+	const char*		name;
+	int				defvalue;
+};
+
+struct BuiltinCommand
+{
+	const char*		name;
+	int				number;
+	int				minargs;
+	DataType		returnvalue;
+	int				firstarg; // index in g_BuiltinArguments
+	int				numargs;
+	const char*		origin; // where in the definitions file it was defined
+};
+
+struct BuiltinEvent
+{
+	const char*		name;
+	int				number;
+};
+
+void		preloadBuiltinDefinitions (CompilerContext* context);
+const char*	builtinDefinitionsFile();
+void		writeBuiltinDefinitions (CompilerContext* context, const String& fileName,
+				const String& outfile);
+
+#endif // BOTC_BUILTINS_H
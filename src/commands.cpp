@@ -32,35 +32,6 @@
 #include "main.h"
 #include "string.h"
 #include "commands.h"
-#include "lexer.h"
-
-static List<CommandInfo*> gCommands;
-
-// ============================================================================
-//
-void addCommandDefinition (CommandInfo* comm)
-{
-	// Ensure that there is no conflicts
-	for (CommandInfo* it : gCommands)
-		if (it->number == comm->number)
-			error ("Attempted to redefine command #%1 (%2) as %3",
-				   gCommands[comm->number]->name, comm->name);
-
-	gCommands << comm;
-}
-
-// ============================================================================
-// Finds a command by name
-CommandInfo* findCommandByName (String fname)
-{
-	for (CommandInfo* comm : gCommands)
-	{
-		if (fname.toUppercase() == comm->name.toUppercase())
-			return comm;
-	}
-
-	return null;
-}
 
 // ============================================================================
 //
@@ -116,8 +87,3 @@ String CommandInfo::signature()
 	text += ')';
 	return text;
 }
-
-const List<CommandInfo*>& getCommands()
-{
-	return gCommands;
-}
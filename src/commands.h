@@ -46,13 +46,9 @@ struct CommandInfo
 	int						minargs;
 	DataType				returnvalue;
 	List<CommandArgument>	args;
-	String					origin;
+	String					origin; // where it was defined, as "file:line"
 
 	String	signature();
 };
 
-void						addCommandDefinition (CommandInfo* comm);
-CommandInfo*				findCommandByName (String a);
-const List<CommandInfo*>&	getCommands();
-
 #endif // BOTC_COMMANDS_H
@@ -0,0 +1,214 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "compilerContext.h"
+#include "commands.h"
+#include "events.h"
+#include "dataBuffer.h"
+
+static thread_local CompilerContext* gCurrentContext = null;
+
+// =============================================================================
+//
+CompilerContext::CompilerContext() :
+	m_lexer (null),
+	m_isDiscarding (false),
+	m_freeChunks() {}
+
+// =============================================================================
+//
+CompilerContext::~CompilerContext()
+{
+	for (DataBuffer* buffer : m_freeBuffers)
+		delete buffer;
+}
+
+// =============================================================================
+//
+void CompilerContext::addCommandDefinition (CommandInfo* comm)
+{
+	// Ensure that there is no conflicts
+	auto it = m_commandsByNumber.find (comm->number);
+
+	if (it != m_commandsByNumber.end())
+	{
+		error ("Attempted to redefine command #%1 (%2, defined at %3) as %4",
+			comm->number, it->second->name, it->second->origin, comm->name);
+	}
+
+	m_commandsByNumber[comm->number] = comm;
+	m_commands << comm;
+
+	// If there are several commands of the same name, the first one is used
+	NameInfo& info = m_names.info (m_names.intern (comm->name));
+
+	if (info.command == null)
+		info.command = comm;
+}
+
+// =============================================================================
+//
+void CompilerContext::addEvent (EventDefinition* e)
+{
+	m_events << e;
+	NameInfo& info = m_names.info (m_names.intern (e->name));
+
+	if (info.event == null)
+		info.event = e;
+}
+
+// =============================================================================
+//
+EventDefinition* CompilerContext::findEventByName (const String& name)
+{
+	int id = m_names.find (name);
+	return (id != -1) ? m_names.info (id).event : null;
+}
+
+// =============================================================================
+//
+// Returns an empty data buffer, reusing one that has been recycled if there is
+// one. Recycled buffers keep their first chunk, so most of them have room to
+// write to already.
+//
+DataBuffer* CompilerContext::makeBuffer()
+{
+	DataBuffer* buffer;
+
+	if (m_freeBuffers.pop (buffer))
+	{
+		buffer->reset();
+		return buffer;
+	}
+
+	return new DataBuffer (this);
+}
+
+// =============================================================================
+//
+// Hands a data buffer that is no longer needed back for reuse.
+//
+void CompilerContext::recycleBuffer (DataBuffer* buffer)
+{
+	if (buffer != null)
+		m_freeBuffers << buffer;
+}
+
+// =============================================================================
+//
+// Returns the free list that chunks of @capacity bytes go to: the one of the
+// smallest size that is large enough, or the last one if none is.
+//
+int CompilerContext::chunkClass (int capacity)
+{
+	static_assert ((DataChunk::DefaultSize << (NumChunkClasses - 1)) == DataChunk::MaxGrowth,
+		"chunk classes must reach up to DataChunk::MaxGrowth");
+	int sizeClass = 0;
+
+	while (sizeClass < NumChunkClasses && (DataChunk::DefaultSize << sizeClass) < capacity)
+		sizeClass++;
+
+	return sizeClass;
+}
+
+// =============================================================================
+//
+// Returns an empty data buffer chunk with room for at least @capacity bytes.
+// Up to DataChunk::MaxGrowth bytes, the capacity is rounded up to a power of
+// two so that recycled chunks of the same size can be taken instead. Larger
+// ones are taken from the recycled ones if one of them is large enough.
+//
+DataChunk* CompilerContext::makeChunk (int capacity)
+{
+	int sizeClass = chunkClass (capacity);
+	DataChunk** list = &m_freeChunks[sizeClass];
+	DataChunk* chunk;
+
+	if (sizeClass == NumChunkClasses)
+	{
+		while (*list != null && (*list)->capacity < capacity)
+			list = &(*list)->next;
+	}
+	else
+		capacity = DataChunk::DefaultSize << sizeClass;
+
+	if (*list != null)
+	{
+		chunk = *list;
+		*list = chunk->next;
+	}
+	else
+	{
+		chunk = static_cast<DataChunk*> (m_arena.allocate (sizeof (DataChunk) + capacity, alignof (DataChunk)));
+		chunk->capacity = capacity;
+	}
+
+	chunk->next = null;
+	chunk->used = 0;
+	return chunk;
+}
+
+// =============================================================================
+//
+// Hands a chain of chunks back for reuse.
+//
+void CompilerContext::recycleChunks (DataChunk* chunks)
+{
+	while (chunks != null)
+	{
+		DataChunk* next = chunks->next;
+		DataChunk*& list = m_freeChunks[chunkClass (chunks->capacity)];
+		chunks->next = list;
+		list = chunks;
+		chunks = next;
+	}
+}
+
+// =============================================================================
+//
+// Returns the context made current on this thread, or null if there is none.
+//
+CompilerContext* CompilerContext::current()
+{
+	return gCurrentContext;
+}
+
+// =============================================================================
+//
+CompilerContext::Scope::Scope (CompilerContext* context) :
+	m_previous (gCurrentContext)
+{
+	gCurrentContext = context;
+}
+
+// =============================================================================
+//
+CompilerContext::Scope::~Scope()
+{
+	gCurrentContext = m_previous;
+}
@@ -0,0 +1,139 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_COMPILER_CONTEXT_H
+#define BOTC_COMPILER_CONTEXT_H
+
+#include <map>
+#include "main.h"
+#include "arena.h"
+#include "nameTable.h"
+#include "stringTable.h"
+#include "markTable.h"
+
+class Lexer;
+class DataBuffer;
+struct DataChunk;
+struct CommandInfo;
+struct EventDefinition;
+
+// =============================================================================
+//
+// The state of a single compilation: the commands and events it knows of, the
+// names they go by, its string table, the marks of its bytecode and the arena
+// its objects are made in, along with the data buffers and chunks that are free
+// for reuse.
+// Contexts share nothing, so compilations with contexts of their own can run
+// at the same time on different threads.
+//
+// The lexer, the parser and data buffers are given their context explicitly.
+// Only error() has to find it on its own, to report the position of the
+// lexer, so threads working on a compilation make its context current with a
+// Scope.
+//
+class CompilerContext
+{
+	PROPERTY (public, Lexer*,	lexer,			setLexer,		STOCK_WRITE)
+	PROPERTY (public, bool,		isDiscarding,	setDiscarding,	STOCK_WRITE)
+
+	public:
+		// Makes a context the current one of this thread for as long as it
+		// exists.
+		class Scope
+		{
+			public:
+				Scope (CompilerContext* context);
+				~Scope();
+
+			private:
+				CompilerContext*	m_previous;
+		};
+
+		CompilerContext();
+		~CompilerContext();
+
+		void				addCommandDefinition (CommandInfo* comm);
+		void				addEvent (EventDefinition* e);
+		EventDefinition*	findEventByName (const String& name);
+		DataBuffer*			makeBuffer();
+		DataChunk*			makeChunk (int capacity);
+		void				recycleBuffer (DataBuffer* buffer);
+		void				recycleChunks (DataChunk* chunks);
+
+		static CompilerContext* current();
+
+		inline Arena& arena()
+		{
+			return m_arena;
+		}
+
+		inline NameTable& names()
+		{
+			return m_names;
+		}
+
+		inline StringTable& stringTable()
+		{
+			return m_stringTable;
+		}
+
+		inline MarkTable& marks()
+		{
+			return m_marks;
+		}
+
+		inline const List<CommandInfo*>& commands() const
+		{
+			return m_commands;
+		}
+
+		inline const List<EventDefinition*>& events() const
+		{
+			return m_events;
+		}
+
+	private:
+		// Free chunks are kept by size. Chunk sizes are powers of two from
+		// DataChunk::DefaultSize to DataChunk::MaxGrowth, one list for each,
+		// and the last list has the ones that are larger still.
+		enum { NumChunkClasses = 10 };
+
+		static int						chunkClass (int capacity);
+
+		Arena							m_arena;
+		NameTable						m_names;
+		StringTable						m_stringTable;
+		MarkTable						m_marks;
+		List<CommandInfo*>				m_commands;
+		std::map<int, CommandInfo*>		m_commandsByNumber;
+		List<EventDefinition*>			m_events;
+		DataChunk*						m_freeChunks[NumChunkClasses + 1];
+		List<DataBuffer*>				m_freeBuffers;
+};
+
+#endif // BOTC_COMPILER_CONTEXT_H
@@ -30,119 +30,229 @@
 
 // ============================================================================
 //
-DataBuffer::DataBuffer (int size)
+DataBuffer::DataBuffer (CompilerContext* context) :
+	m_context (context),
+	m_head (null),
+	m_tail (null),
+	m_size (0),
+	m_segment (null),
+	m_references (-1),
+	m_lastReference (-1)
 {
-	setBuffer (new char[size]);
-	setPosition (&buffer()[0]);
-	setAllocatedSize (size);
+	reset();
 }
 
 // ============================================================================
 //
-DataBuffer::~DataBuffer()
+DataBuffer::DataBuffer (DataBuffer&& other) :
+	m_context (other.m_context),
+	m_head (other.m_head),
+	m_tail (other.m_tail),
+	m_size (other.m_size),
+	m_segment (other.m_segment),
+	m_references (other.m_references),
+	m_lastReference (other.m_lastReference)
 {
-	ASSERT (marks().isEmpty());
-	ASSERT (references().isEmpty());
-	delete buffer();
+	other.m_head = null;
+	other.m_tail = null;
+	other.m_size = 0;
+	other.m_segment = null;
+	other.m_references = -1;
+	other.m_lastReference = -1;
 }
 
 // ============================================================================
 //
-void DataBuffer::mergeAndDestroy (DataBuffer* other)
+DataBuffer::~DataBuffer()
 {
-	if (other == null)
-		return;
-
-	// Note: We transfer the marks before the buffer is copied, so that the
-	// offset uses the proper value (which is the written size of @other, which
-	// we don't want our written size to be added to yet).
-	other->transferMarksTo (this);
-	copyBuffer (other);
-	delete other;
+	context()->recycleChunks (m_head);
 }
 
 // ============================================================================
 //
-// Clones this databuffer to a new one and returns it. Note that the original
-// transfers its marks and references and loses them in the process.
+// Empties the buffer so that it can be used again. The first chunk is kept for
+// the next bytes to go into; any others are handed back to the context. The
+// marks made in the buffer so far stay in the segment they were made in.
 //
-DataBuffer* DataBuffer::clone()
+void DataBuffer::reset()
 {
-	DataBuffer* other = new DataBuffer;
-	transferMarksTo (other);
-	other->copyBuffer (this);
-	return other;
+	if (m_head != null)
+	{
+		context()->recycleChunks (m_head->next);
+		m_head->next = null;
+		m_head->used = 0;
+	}
+
+	m_tail = m_head;
+	m_size = 0;
+	m_references = -1;
+	m_lastReference = -1;
+	m_segment = null;
+
+	if (context()->isDiscarding() == false)
+	{
+		m_segment = context()->arena().make<DataSegment>();
+		m_segment->parent = null;
+		m_segment->offset = 0;
+	}
 }
 
 // ============================================================================
 //
-void DataBuffer::copyBuffer (const DataBuffer* buf)
+void DataBuffer::mergeAndDestroy (DataBuffer* other)
 {
-	checkSpace (buf->writtenSize());
-	memcpy (m_position, buf->buffer(), buf->writtenSize());
-	m_position += buf->writtenSize();
+	if (other == null)
+		return;
+
+	// Discarding buffers have nothing to take over.
+	if (isDiscarding() == false && other->isDiscarding() == false)
+	{
+		// Whatever was written to @other now lies after what we have so far.
+		other->m_segment->parent = m_segment;
+		other->m_segment->offset = writtenSize();
+
+		if (other->m_references != -1)
+		{
+			if (m_references == -1)
+				m_references = other->m_references;
+			else
+				context()->marks().reference (m_lastReference).next = other->m_references;
+
+			m_lastReference = other->m_lastReference;
+		}
+
+		if (other->m_head != null)
+		{
+			// Small buffers are copied over rather than linked, so that the
+			// chain does not end up as a lot of nearly empty chunks. The chunk
+			// stays with @other for its next use.
+			if (m_tail != null
+				&& other->m_head == other->m_tail
+				&& other->writtenSize() <= m_tail->capacity - m_tail->used)
+			{
+				memcpy (position(), other->m_head->data(), other->writtenSize());
+				advance (other->writtenSize());
+			}
+			else
+			{
+				if (m_tail != null)
+					m_tail->next = other->m_head;
+				else
+					m_head = other->m_head;
+
+				m_tail = other->m_tail;
+				m_size += other->writtenSize();
+				other->m_head = null;
+				other->m_tail = null;
+			}
+		}
+	}
+
+	context()->recycleBuffer (other);
 }
 
 // ============================================================================
 //
-void DataBuffer::transferMarksTo (DataBuffer* dest)
+void DataBuffer::flatten()
 {
-	int offset = dest->writtenSize();
+	if (isDiscarding())
+		return;
 
-	for (ByteMark* mark : marks())
+	if (m_head != m_tail)
 	{
-		mark->pos += offset;
-		dest->m_marks << mark;
+		DataChunk* chunk = context()->makeChunk (writtenSize());
+
+		for (DataChunk* it = m_head; it != null; it = it->next)
+		{
+			memcpy (chunk->data() + chunk->used, it->data(), it->used);
+			chunk->used += it->used;
+		}
+
+		context()->recycleChunks (m_head);
+		m_head = m_tail = chunk;
 	}
 
-	for (MarkReference* ref : references())
+	MarkTable& marks = context()->marks();
+
+	for (int32_t i = m_references; i != -1; i = marks.reference (i).next)
 	{
-		ref->pos += offset;
-		dest->m_references << ref;
+		const MarkTable::Reference& ref = marks.reference (i);
+		const MarkTable::Mark& target = marks.mark (ref.target);
+		int pos = MarkTable::resolve (ref.segment, ref.pos, m_segment);
+		int value = MarkTable::resolve (target.segment, target.pos, m_segment);
+
+		for (int j = 0; j < 4; ++j)
+			m_head->data()[pos + j] = (value >> (8 * j)) & 0xFF;
 	}
+}
 
-	m_marks.clear();
-	m_references.clear();
+// ============================================================================
+//
+const char* DataBuffer::data() const
+{
+	ASSERT_EQ (m_head, m_tail);
+	return (m_head != null) ? m_head->data() : null;
 }
 
 // ============================================================================
 //
-ByteMark* DataBuffer::addMark (const String& name)
+ByteMark DataBuffer::addMark()
 {
-	ByteMark* mark = new ByteMark;
-	mark->name = name;
-	mark->pos = writtenSize();
-	m_marks << mark;
-	return mark;
+	if (isDiscarding())
+		return ByteMark();
+
+	return context()->marks().addMark (m_segment, writtenSize());
 }
 
 // ============================================================================
 //
-MarkReference* DataBuffer::addReference (ByteMark* mark)
+void DataBuffer::addReference (ByteMark mark)
 {
-	MarkReference* ref = new MarkReference;
-	ref->target = mark;
-	ref->pos = writtenSize();
-	m_references << ref;
+	if (isDiscarding())
+		return;
 
-	// Write a dummy placeholder for the reference
-	writeDWord (0xBEEFCAFE);
+	reserve (4);
+	putReference (mark);
+}
+
+// ============================================================================
+//
+void DataBuffer::putReference (ByteMark mark)
+{
+	MarkTable& marks = context()->marks();
+	int32_t ref = marks.addReference (mark, m_segment, writtenSize());
+
+	if (m_references == -1)
+		m_references = ref;
+	else
+		marks.reference (m_lastReference).next = ref;
 
-	return ref;
+	m_lastReference = ref;
+
+	// Write a dummy placeholder for the reference
+	putDWord (0xBEEFCAFE);
 }
 
 // ============================================================================
 //
-void DataBuffer::adjustMark (ByteMark* mark)
+void DataBuffer::adjustMark (ByteMark mark)
 {
-	mark->pos = writtenSize();
+	if (isDiscarding())
+		return;
+
+	MarkTable::Mark& info = context()->marks().mark (mark);
+	info.segment = m_segment;
+	info.pos = writtenSize();
 }
 
 // ============================================================================
 //
-void DataBuffer::offsetMark (ByteMark* mark, int position)
+void DataBuffer::offsetMark (ByteMark mark, int position)
 {
-	mark->pos += position;
+	if (isDiscarding())
+		return;
+
+	context()->marks().mark (mark).pos += position;
 }
 
 // ============================================================================
@@ -150,94 +260,100 @@ void DataBuffer::offsetMark (ByteMark* mark, int position)
 void DataBuffer::writeStringIndex (const String& a)
 {
 	writeDWord (DH_PushStringIndex);
-	writeDWord (getStringTableIndex (a));
+	writeDWord (context()->stringTable().getIndex (a));
 }
 
 // ============================================================================
 //
 void DataBuffer::dump()
 {
-	for (int i = 0; i < writtenSize(); ++i)
-		printf ("%d. [0x%X]\n", i, buffer()[i]);
+	int i = 0;
+
+	for (DataChunk* chunk = m_head; chunk != null; chunk = chunk->next)
+		for (int j = 0; j < chunk->used; ++j)
+			printf ("%d. [0x%X]\n", i++, chunk->data()[j]);
 }
 
 // ============================================================================
 //
-void DataBuffer::checkSpace (int bytes)
+void DataBuffer::reserve (int bytes)
 {
-	int writesize = writtenSize();
-
-	if (writesize + bytes < allocatedSize())
+	if (m_tail != null && m_tail->used + bytes <= m_tail->capacity)
 		return;
 
-	// We don't have enough space in the buffer to write
-	// the stuff - thus resize. First, store the old
-	// buffer temporarily:
-	char* copy = new char[allocatedSize()];
-	memcpy (copy, buffer(), allocatedSize());
+	// Whatever room is left in the last chunk stays unused; only the bytes
+	// written to a chunk count. Growing geometrically keeps the chain short
+	// for large buffers.
+	int capacity = DataChunk::DefaultSize;
+
+	if (m_tail != null)
+		capacity = min<int> (m_tail->capacity * 2, DataChunk::MaxGrowth);
 
-	// Remake the buffer with the new size. Have enough space
-	// for the stuff we're going to write, as well as a bit
-	// of leeway so we don't have to resize immediately again.
-	int newsize = allocatedSize() + bytes + 512;
+	DataChunk* chunk = context()->makeChunk (max (capacity, bytes));
 
-	delete buffer();
-	setBuffer (new char[newsize]);
-	setAllocatedSize (newsize);
+	if (m_tail != null)
+		m_tail->next = chunk;
+	else
+		m_head = chunk;
 
-	// Now, copy the stuff back.
-	memcpy (m_buffer, copy, allocatedSize());
-	setPosition (buffer() + writesize);
-	delete copy;
+	m_tail = chunk;
 }
 
 // =============================================================================
 //
 void DataBuffer::writeByte (int8_t data)
 {
-	checkSpace (1);
-	*m_position++ = data;
+	if (isDiscarding())
+		return;
+
+	reserve (1);
+	*position() = data;
+	advance (1);
 }
 
 // =============================================================================
 //
 void DataBuffer::writeWord (int16_t data)
 {
-	checkSpace (2);
+	if (isDiscarding())
+		return;
+
+	reserve (2);
+	char* pos = position();
 
 	for (int i = 0; i < 2; ++i)
-		*m_position++ = (data >> (i * 8)) & 0xFF;
+		pos[i] = (data >> (i * 8)) & 0xFF;
+
+	advance (2);
 }
 
 // =============================================================================
 //
 void DataBuffer::writeDWord (int32_t data)
 {
-	checkSpace (4);
+	if (isDiscarding())
+		return;
 
-	for (int i = 0; i < 4; ++i)
-		*m_position++ = (data >> (i * 8)) & 0xFF;
+	reserve (4);
+	putDWord (data);
 }
 
 // =============================================================================
 //
 void DataBuffer::writeString (const String& a)
 {
-	checkSpace (a.length() + 4);
-	writeDWord (a.length());
+	if (isDiscarding())
+		return;
 
-	for (char c : a)
-		writeByte (c);
+	reserve (a.length() + 4);
+	putString (a);
 }
 
-
 // =============================================================================
 //
-ByteMark* DataBuffer::findMarkByName (const String& name)
+void DataBuffer::putString (const String& a)
 {
-	for (ByteMark* mark : marks())
-		if (mark->name == name)
-			return mark;
-
-	return null;
+	putDWord (a.length());
+	memcpy (position(), a.chars(), a.length());
+	advance (a.length());
 }
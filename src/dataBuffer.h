@@ -32,16 +32,48 @@
 #include <stdio.h>
 #include <string.h>
 #include "main.h"
-#include "stringTable.h"
+#include "compilerContext.h"
+#include "markTable.h"
+
+// =============================================================================
+//
+// A piece of a buffer's bytes. Chunks are made in the compilation arena and
+// kept for reuse once their buffer is gone, see CompilerContext::makeChunk.
+//
+struct DataChunk
+{
+	enum
+	{
+		DefaultSize = 128,
+		MaxGrowth = 64 * 1024,
+	};
+
+	DataChunk*	next;
+	int			capacity;
+	int			used;
+
+	inline char* data()
+	{
+		return reinterpret_cast<char*> (this + 1);
+	}
+};
 
 /**
  *    @class DataBuffer
  *    @brief Stores a buffer of bytecode
  *
- *    The DataBuffer class stores a section of bytecode. Buffers are allocated on
- *    the heap and written to using the @c write* functions. Buffers can be cut and
- *    pasted together with @c mergeAndDestroy, note that this function destroys the
- *    parameter buffer in the process
+ *    The DataBuffer class stores a section of bytecode. Buffers are made with
+ *    @c CompilerContext::makeBuffer and written to using the @c write* functions.
+ *    Buffers can be cut and pasted together with @c mergeAndDestroy, note that
+ *    this function recycles the parameter buffer in the process. Buffers that
+ *    are not merged anywhere are given back with
+ *    @c CompilerContext::recycleBuffer. Buffers own their bytes, so they can be
+ *    moved but not copied.
+ *
+ *    The bytes are kept in a chain of chunks. Merging a buffer into another
+ *    links its chunks after the other's instead of copying them, so the cost of
+ *    emitting code does not depend on how deeply it is nested. The chain is laid
+ *    out contiguously only once, by @c flatten.
  *
  *    A mark is a "pointer" to a particular position in the bytecode. The actual
  *    permanent position cannot be predicted in any way or form, thus these things
@@ -52,72 +84,87 @@
  *    is written to the output file.
  *
  *    This mark/reference system is used to know bytecode offset values when
- *    compiling, even though actual final positions cannot be known.
+ *    compiling, even though actual final positions cannot be known. Marks and
+ *    references are kept in the MarkTable of the compilation, positioned
+ *    relative to the segment of the buffer they were made in. A merge only
+ *    records where that segment went, and the final positions are worked out
+ *    when the buffer is flattened.
+ *
+ *    Buffers belong to a compilation, whose context holds the string table and
+ *    its marks. When only checking scripts, emission can be turned off with
+ *    @c CompilerContext::setDiscarding. Buffers created after that allocate no
+ *    storage, write nothing and keep no marks or references. The marks they
+ *    hand out refer to nothing.
  */
 class DataBuffer
 {
 	//! @
-	PROPERTY (private, char*,					buffer,			setBuffer,			STOCK_WRITE)
-	PROPERTY (private, int,						allocatedSize,	setAllocatedSize,	STOCK_WRITE)
-	PROPERTY (private, char*,					position,		setPosition,		STOCK_WRITE)
-	PROPERTY (private, List<ByteMark*>,			marks,			setMarks,			STOCK_WRITE)
-	PROPERTY (private, List<MarkReference*>,	references,		setReferences,		STOCK_WRITE)
+	PROPERTY (private, CompilerContext*,		context,		setContext,			STOCK_WRITE)
+
+	friend class Emitter;
 
 	public:
-		//! Constructs a new databuffer with @c size bytes.
-		DataBuffer (int size = 128);
+		//! Constructs a new, empty databuffer.
+		//! @param context the compilation the buffer belongs to
+		DataBuffer (CompilerContext* context);
+
+		//! Takes the bytes, marks and references of @c other, which is left
+		//! without storage and must not be written to anymore.
+		DataBuffer (DataBuffer&& other);
+
+		DataBuffer (const DataBuffer&) = delete;
+		DataBuffer& operator= (const DataBuffer&) = delete;
 
 		//! Destructs the databuffer.
 		~DataBuffer();
 
-		//! Adds a new mark to the current position with the name @c name.
-		//! @param name the name of the new mark
-		//! @return a pointer to the new mark
-		ByteMark*		addMark (const String& name);
+		//! Adds a new mark to the current position.
+		//! @return a handle to the new mark
+		ByteMark		addMark();
 
 		//! Adds a new reference to @c mark at the current position. This
 		//! function will write 4 bytes to the buffer whose value will
 		//! be determined at final output writing.
 		//! @param mark the mark which the new reference will attach to
-		//! @return a pointer to the new reference
-		MarkReference*	addReference (ByteMark* mark);
+		void			addReference (ByteMark mark);
 
 		//! Moves @c mark to the current bytecode position.
 		//! @param mark the mark to adjust
-		void			adjustMark (ByteMark* mark);
+		void			adjustMark (ByteMark mark);
 
-		//! Ensures there's at least @c bytes left in the buffer. Will resize
-		//! if necessary, no-op if not. On resize, 512 extra bytes are allocated
-		//! to reduce the amount of resizes.
-		//! @param bytes the amount of space in bytes to ensure allocated
-		void			checkSpace (int bytes);
-
-		//! Creates a clone of this data buffer.
-		//! @note All marks will be moved into the new databuffer as marks are
-		//! @note never duplicated.
-		//! @return The newly cloned databuffer.
-		DataBuffer*		clone();
+		//! @return the bytes of this buffer, which must have been flattened.
+		const char*		data() const;
 
 		//! Prints the buffer to stdout. Useful for debugging.
 		void			dump();
 
-		//! Finds the given mark by name.
-		//! @param name the name of the mark to find
-		ByteMark*		findMarkByName (const String& name);
+		//! Lays the bytes of this buffer out contiguously and fills in the
+		//! positions of all references in it. Every mark referenced must have
+		//! been merged into this buffer by now.
+		void			flatten();
 
-		//! Merge another data buffer into this one.
-		//! Note: @c other is destroyed in the process.
+		//! Merge another data buffer into this one. The chunks of @c other
+		//! are linked after ours, unless its bytes fit in the space left in
+		//! our last chunk, in which case they are copied there.
+		//! Note: @c other is handed back to the context for reuse in the
+		//! process, so it must not be used afterwards.
 		//! @param other the buffer to merge in
 		void			mergeAndDestroy (DataBuffer* other);
 
 		//! Moves @c mark to the given bytecode position.
 		//! @param mark the mark to adjust
 		//! @param position where to adjust the mark
-		void			offsetMark (ByteMark* mark, int position);
+		void			offsetMark (ByteMark mark, int position);
 
-		//! Transfers all marks of this buffer to @c other.
-		//! @param other the data buffer to transfer marks to
-		void			transferMarksTo (DataBuffer* other);
+		//! Empties the buffer for reuse. Its first chunk is kept.
+		void			reset();
+
+		//! Ensures there's at least @c bytes of contiguous space left in the
+		//! last chunk, so that they can be written without checking again.
+		//! Starts a new chunk if necessary, no-op if not. New chunks are twice
+		//! as large as the last one, up to @c DataChunk::MaxGrowth bytes.
+		//! @param bytes the amount of space in bytes to ensure allocated
+		void			reserve (int bytes);
 
 		//! Writes the index of the given string to the databuffer.
 		//! 4 bytes will be written to the bytecode.
@@ -144,14 +191,56 @@ class DataBuffer
 		//! @return the amount of bytes written to this buffer.
 		inline int		writtenSize() const
 		{
-			return position() - buffer();
+			return m_size;
+		}
+
+		//! @return whether this buffer discards everything written to it.
+		inline bool		isDiscarding() const
+		{
+			return m_segment == null;
 		}
 
-	protected:
-		//! Writes the buffer's contents from @c buf.
-		//! @c buf.writtenSize() bytes will be written.
-		//! @param buf the buffer to copy
-		void			copyBuffer (const DataBuffer* buf);
+	private:
+		DataChunk*		m_head;
+		DataChunk*		m_tail;
+		int				m_size;
+		DataSegment*	m_segment;
+		int32_t			m_references;
+		int32_t			m_lastReference;
+
+		//! @return where the next byte is to be written to.
+		inline char*	position()
+		{
+			return m_tail->data() + m_tail->used;
+		}
+
+		//! Accounts for @c bytes written at position().
+		inline void		advance (int bytes)
+		{
+			m_tail->used += bytes;
+			m_size += bytes;
+		}
+
+		//! Writes a double word in little-endian byte order into space made
+		//! with reserve().
+		inline void		putDWord (int32_t data)
+		{
+#ifdef DEBUG
+			ASSERT_LT_EQ (m_tail->used + 4, m_tail->capacity);
+#endif
+			char* pos = position();
+
+			for (int i = 0; i < 4; ++i)
+				pos[i] = (data >> (i * 8)) & 0xFF;
+
+			advance (4);
+		}
+
+		//! Adds a reference to @c mark into space made with reserve().
+		void			putReference (ByteMark mark);
+
+		//! Writes a string into space made with reserve().
+		void			putString (const String& a);
 };
 
 #endif // BOTC_DATABUFFER_H
@@ -26,42 +26,55 @@
 	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-// TODO: this file is a freeloader, I should probably get rid of it
+#ifndef BOTC_DATA_READER_H
+#define BOTC_DATA_READER_H
 
-#include <stdlib.h>
-#include <stdio.h>
+#include <cstring>
 #include "main.h"
-#include "string.h"
-#include "events.h"
-#include "lexer.h"
 
-static List<EventDefinition*> g_Events;
-
-// ============================================================================
-//
-void addEvent (EventDefinition* e)
-{
-	g_Events << e;
-}
-
-// ============================================================================
+// =============================================================================
 //
-// Finds an event definition by index
+// Reads values out of a block of memory, such as a mapped file, refusing to
+// read past its end.
 //
-EventDefinition* findEventByIndex (int idx)
+class DataReader
 {
-	return g_Events[idx];
-}
+public:
+	DataReader (const char* data, long size) :
+		m_position (data),
+		m_end (data + size) {}
 
-// ============================================================================
-//
-// Finds an event definition by name
-//
-EventDefinition* findEventByName (String a)
-{
-	for (EventDefinition* e : g_Events)
-		if (a.toUppercase() == e->name.toUppercase())
-			return e;
+	bool read (void* dest, long size)
+	{
+		if (m_end - m_position < size)
+			return false;
+
+		memcpy (dest, m_position, size);
+		m_position += size;
+		return true;
+	}
+
+	// Strings are stored as their length and characters.
+	bool readString (String& str)
+	{
+		uint32_t length;
+
+		if (read (&length, sizeof length) == false || m_end - m_position < length)
+			return false;
+
+		str = String (m_position, length);
+		m_position += length;
+		return true;
+	}
+
+	inline long remaining() const
+	{
+		return m_end - m_position;
+	}
+
+private:
+	const char*	m_position;
+	const char*	m_end;
+};
 
-	return null;
-}
+#endif // BOTC_DATA_READER_H
@@ -0,0 +1,266 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_EMITTER_H
+#define BOTC_EMITTER_H
+
+#include <type_traits>
+#include "main.h"
+#include "botStuff.h"
+#include "dataBuffer.h"
+
+// =============================================================================
+//
+// Describes the instruction of a data header. @operands has a character for
+// every operand that follows the header in the bytecode:
+//
+//     i - a number
+//     m - a branch target, written as a reference to a mark
+//     s - a string, written as its length and characters
+//
+struct InstructionInfo
+{
+	const char*	operands;
+};
+
+constexpr InstructionInfo gInstructions[] =
+{
+	{ "ii" },	// DH_Command (command number, argument count)
+	{ "i" },	// DH_StateIndex
+	{ "s" },	// DH_StateName
+	{ "" },		// DH_OnEnter
+	{ "" },		// DH_MainLoop
+	{ "" },		// DH_OnExit
+	{ "i" },	// DH_Event
+	{ "" },		// DH_EndOnEnter
+	{ "" },		// DH_EndMainLoop
+	{ "" },		// DH_EndOnExit
+	{ "" },		// DH_EndEvent
+	{ "m" },	// DH_IfGoto
+	{ "m" },	// DH_IfNotGoto
+	{ "m" },	// DH_Goto
+	{ "" },		// DH_OrLogical
+	{ "" },		// DH_AndLogical
+	{ "" },		// DH_OrBitwise
+	{ "" },		// DH_EorBitwise
+	{ "" },		// DH_AndBitwise
+	{ "" },		// DH_Equals
+	{ "" },		// DH_NotEquals
+	{ "" },		// DH_LessThan
+	{ "" },		// DH_AtMost
+	{ "" },		// DH_GreaterThan
+	{ "" },		// DH_AtLeast
+	{ "" },		// DH_NegateLogical
+	{ "" },		// DH_LeftShift
+	{ "" },		// DH_RightShift
+	{ "" },		// DH_Add
+	{ "" },		// DH_Subtract
+	{ "" },		// DH_UnaryMinus
+	{ "" },		// DH_Multiply
+	{ "" },		// DH_Divide
+	{ "" },		// DH_Modulus
+	{ "i" },	// DH_PushNumber
+	{ "i" },	// DH_PushStringIndex
+	{ "i" },	// DH_PushGlobalVar
+	{ "i" },	// DH_PushLocalVar
+	{ "" },		// DH_DropStackPosition
+	{ "" },		// DH_ScriptVarList (not written by botc)
+	{ "i" },	// DH_StringList (string count, the strings follow)
+	{ "i" },	// DH_IncreaseGlobalVar
+	{ "i" },	// DH_DecreaseGlobalVar
+	{ "i" },	// DH_AssignGlobalVar
+	{ "i" },	// DH_AddGlobalVar
+	{ "i" },	// DH_SubtractGlobalVar
+	{ "i" },	// DH_MultiplyGlobalVar
+	{ "i" },	// DH_DivideGlobalVar
+	{ "i" },	// DH_ModGlobalVar
+	{ "i" },	// DH_IncreaseLocalVar
+	{ "i" },	// DH_DecreaseLocalVar
+	{ "i" },	// DH_AssignLocalVar
+	{ "i" },	// DH_AddLocalVar
+	{ "i" },	// DH_SubtractLocalVar
+	{ "i" },	// DH_MultiplyLocalVar
+	{ "i" },	// DH_DivideLocalVar
+	{ "i" },	// DH_ModLocalVar
+	{ "im" },	// DH_CaseGoto
+	{ "" },		// DH_Drop
+	{ "i" },	// DH_IncreaseGlobalArray
+	{ "i" },	// DH_DecreaseGlobalArray
+	{ "i" },	// DH_AssignGlobalArray
+	{ "i" },	// DH_AddGlobalArray
+	{ "i" },	// DH_SubtractGlobalArray
+	{ "i" },	// DH_MultiplyGlobalArray
+	{ "i" },	// DH_DivideGlobalArray
+	{ "i" },	// DH_ModGlobalArray
+	{ "i" },	// DH_PushGlobalArray
+	{ "" },		// DH_Swap
+	{ "" },		// DH_Dup
+	{ "" },		// DH_ArraySet (not written by botc)
+};
+
+static_assert (countof (gInstructions) == numDataHeaders, "every data header needs an entry in gInstructions");
+
+// =============================================================================
+//
+// The operand character of gInstructions that a C++ type is written as.
+//
+template<typename T>
+struct OperandKind
+{
+	static constexpr char value =
+		(std::is_integral<T>::value || std::is_enum<T>::value) ? 'i' :
+		std::is_same<T, ByteMark>::value ? 'm' :
+		std::is_same<T, String>::value ? 's' : '?';
+};
+
+template<typename... Operands>
+struct OperandSignature;
+
+template<>
+struct OperandSignature<>
+{
+	static constexpr bool matches (const char* operands)
+	{
+		return operands[0] == '\0';
+	}
+};
+
+template<typename T, typename... Rest>
+struct OperandSignature<T, Rest...>
+{
+	static constexpr bool matches (const char* operands)
+	{
+		return operands[0] == OperandKind<typename std::decay<T>::type>::value
+			&& OperandSignature<Rest...>::matches (operands + 1);
+	}
+};
+
+// =============================================================================
+//
+// Writes instructions into a data buffer. Each instruction is written with a
+// single reserve, after which its header and operands are stored without any
+// further checks.
+//
+// When the header is known at compile time, use emit<DH_...> (operands...):
+// the operands are checked against gInstructions as the code is compiled.
+// Headers that are only known at run time are checked against it in debug
+// builds.
+//
+class Emitter
+{
+	public:
+		Emitter (DataBuffer* buffer) :
+			m_buffer (buffer) {}
+
+		template<DataHeader Header, typename... Operands>
+		void emit (const Operands&... operands)
+		{
+			static_assert (OperandSignature<Operands...>::matches (gInstructions[Header].operands),
+				"operands do not match the instruction");
+			write (Header, operands...);
+		}
+
+		template<typename... Operands>
+		void emit (DataHeader header, const Operands&... operands)
+		{
+#ifdef DEBUG
+			ASSERT_RANGE (header, 0, numDataHeaders - 1);
+			ASSERT (OperandSignature<Operands...>::matches (gInstructions[header].operands));
+#endif
+			write (header, operands...);
+		}
+
+	private:
+		DataBuffer* m_buffer;
+
+		template<typename... Operands>
+		void write (DataHeader header, const Operands&... operands)
+		{
+			if (m_buffer->isDiscarding())
+				return;
+
+			m_buffer->reserve (4 + sizeOf (operands...));
+			m_buffer->putDWord (header);
+			writeOperands (operands...);
+		}
+
+		static inline int sizeOf()
+		{
+			return 0;
+		}
+
+		template<typename T, typename... Rest>
+		static inline int sizeOf (const T& first, const Rest&... rest)
+		{
+			return operandSize (first) + sizeOf (rest...);
+		}
+
+		static inline int operandSize (int32_t)
+		{
+			return 4;
+		}
+
+		static inline int operandSize (ByteMark)
+		{
+			return 4;
+		}
+
+		static inline int operandSize (const String& a)
+		{
+			return 4 + a.length();
+		}
+
+		inline void writeOperands() {}
+
+		template<typename T, typename... Rest>
+		inline void writeOperands (const T& first, const Rest&... rest)
+		{
+			writeOperand (first);
+			writeOperands (rest...);
+		}
+
+		inline void writeOperand (int32_t data)
+		{
+			m_buffer->putDWord (data);
+		}
+
+		inline void writeOperand (ByteMark mark)
+		{
+#ifdef DEBUG
+			ASSERT (mark.isValid());
+#endif
+			m_buffer->putReference (mark);
+		}
+
+		inline void writeOperand (const String& a)
+		{
+			m_buffer->putString (a);
+		}
+};
+
+#endif // BOTC_EMITTER_H
@@ -0,0 +1,290 @@
+#pragma once
+#include "botStuff.h"
+#include "expression.h"
+#include "parser.h"
+#include "tokens.h"
+#include "types.h"
+
+static const char* g_DataHeaderNames[] =
+{
+	"DH_Command",
+	"DH_StateIndex",
+	"DH_StateName",
+	"DH_OnEnter",
+	"DH_MainLoop",
+	"DH_OnExit",
+	"DH_Event",
+	"DH_EndOnEnter",
+	"DH_EndMainLoop",
+	"DH_EndOnExit",
+	"DH_EndEvent",
+	"DH_IfGoto",
+	"DH_IfNotGoto",
+	"DH_Goto",
+	"DH_OrLogical",
+	"DH_AndLogical",
+	"DH_OrBitwise",
+	"DH_EorBitwise",
+	"DH_AndBitwise",
+	"DH_Equals",
+	"DH_NotEquals",
+	"DH_LessThan",
+	"DH_AtMost",
+	"DH_GreaterThan",
+	"DH_AtLeast",
+	"DH_NegateLogical",
+	"DH_LeftShift",
+	"DH_RightShift",
+	"DH_Add",
+	"DH_Subtract",
+	"DH_UnaryMinus",
+	"DH_Multiply",
+	"DH_Divide",
+	"DH_Modulus",
+	"DH_PushNumber",
+	"DH_PushStringIndex",
+	"DH_PushGlobalVar",
+	"DH_PushLocalVar",
+	"DH_DropStackPosition",
+	"DH_ScriptVarList",
+	"DH_StringList",
+	"DH_IncreaseGlobalVar",
+	"DH_DecreaseGlobalVar",
+	"DH_AssignGlobalVar",
+	"DH_AddGlobalVar",
+	"DH_SubtractGlobalVar",
+	"DH_MultiplyGlobalVar",
+	"DH_DivideGlobalVar",
+	"DH_ModGlobalVar",
+	"DH_IncreaseLocalVar",
+	"DH_DecreaseLocalVar",
+	"DH_AssignLocalVar",
+	"DH_AddLocalVar",
+	"DH_SubtractLocalVar",
+	"DH_MultiplyLocalVar",
+	"DH_DivideLocalVar",
+	"DH_ModLocalVar",
+	"DH_CaseGoto",
+	"DH_Drop",
+	"DH_IncreaseGlobalArray",
+	"DH_DecreaseGlobalArray",
+	"DH_AssignGlobalArray",
+	"DH_AddGlobalArray",
+	"DH_SubtractGlobalArray",
+	"DH_MultiplyGlobalArray",
+	"DH_DivideGlobalArray",
+	"DH_ModGlobalArray",
+	"DH_PushGlobalArray",
+	"DH_Swap",
+	"DH_Dup",
+	"DH_ArraySet",
+	"numDataHeaders",
+};
+
+inline const char* getDataHeaderString (DataHeader a)
+{
+	return g_DataHeaderNames[a];
+}
+
+static const char* g_ExpressionOperatorTypeNames[] =
+{
+	"OPER_NegateLogical",
+	"OPER_UnaryMinus",
+	"OPER_Multiplication",
+	"OPER_Division",
+	"OPER_Modulus",
+	"OPER_Addition",
+	"OPER_Subtraction",
+	"OPER_LeftShift",
+	"OPER_RightShift",
+	"OPER_CompareLesser",
+	"OPER_CompareGreater",
+	"OPER_CompareAtLeast",
+	"OPER_CompareAtMost",
+	"OPER_CompareEquals",
+	"OPER_CompareNotEquals",
+	"OPER_BitwiseAnd",
+	"OPER_BitwiseXOr",
+	"OPER_BitwiseOr",
+	"OPER_LogicalAnd",
+	"OPER_LogicalOr",
+	"OPER_Ternary",
+};
+
+inline const char* getExpressionOperatorTypeString (ExpressionOperatorType a)
+{
+	return g_ExpressionOperatorTypeNames[a];
+}
+
+static const char* g_MarkTypeNames[] =
+{
+	"MARK_Label",
+	"MARK_If",
+	"MARK_Internal",
+};
+
+inline const char* getMarkTypeString (MarkType a)
+{
+	return g_MarkTypeNames[a];
+}
+
+static const char* g_ScopeTypeNames[] =
+{
+	"SCOPE_Unknown",
+	"SCOPE_If",
+	"SCOPE_While",
+	"SCOPE_For",
+	"SCOPE_Do",
+	"SCOPE_Switch",
+	"SCOPE_Else",
+};
+
+inline const char* getScopeTypeString (ScopeType a)
+{
+	return g_ScopeTypeNames[a];
+}
+
+static const char* g_AssignmentOperatorNames[] =
+{
+	"ASSIGNOP_Assign",
+	"ASSIGNOP_Add",
+	"ASSIGNOP_Subtract",
+	"ASSIGNOP_Multiply",
+	"ASSIGNOP_Divide",
+	"ASSIGNOP_Modulus",
+	"ASSIGNOP_Increase",
+	"ASSIGNOP_Decrease",
+};
+
+inline const char* getAssignmentOperatorString (AssignmentOperator a)
+{
+	return g_AssignmentOperatorNames[a];
+}
+
+static const char* g_WritabilityNames[] =
+{
+	"WRITE_Mutable",
+	"WRITE_Const",
+	"WRITE_Constexpr",
+};
+
+inline const char* getWritabilityString (Writability a)
+{
+	return g_WritabilityNames[a];
+}
+
+static const char* g_ParserModeNames[] =
+{
+	"PARSERMODE_TopLevel",
+	"PARSERMODE_Event",
+	"PARSERMODE_MainLoop",
+	"PARSERMODE_Onenter",
+	"PARSERMODE_Onexit",
+};
+
+inline const char* getParserModeString (ParserMode a)
+{
+	return g_ParserModeNames[a];
+}
+
+static const char* g_ETokenTypeNames[] =
+{
+	"TK_LeftShiftAssign",
+	"TK_RightShiftAssign",
+	"TK_Equals",
+	"TK_NotEquals",
+	"TK_AddAssign",
+	"TK_SubAssign",
+	"TK_MultiplyAssign",
+	"TK_DivideAssign",
+	"TK_ModulusAssign",
+	"TK_LeftShift",
+	"TK_RightShift",
+	"TK_AtLeast",
+	"TK_AtMost",
+	"TK_DoubleAmperstand",
+	"TK_DoubleBar",
+	"TK_DoublePlus",
+	"TK_DoubleMinus",
+	"TK_SingleQuote",
+	"TK_DollarSign",
+	"TK_ParenStart",
+	"TK_ParenEnd",
+	"TK_BracketStart",
+	"TK_BracketEnd",
+	"TK_BraceStart",
+	"TK_BraceEnd",
+	"TK_Assign",
+	"TK_Plus",
+	"TK_Minus",
+	"TK_Multiply",
+	"TK_Divide",
+	"TK_Modulus",
+	"TK_Comma",
+	"TK_Lesser",
+	"TK_Greater",
+	"TK_Dot",
+	"TK_Colon",
+	"TK_Semicolon",
+	"TK_Hash",
+	"TK_ExclamationMark",
+	"TK_Amperstand",
+	"TK_Bar",
+	"TK_Caret",
+	"TK_QuestionMark",
+	"TK_Arrow",
+	"TK_Bool",
+	"TK_Break",
+	"TK_Case",
+	"TK_Continue",
+	"TK_Const",
+	"TK_Constexpr",
+	"TK_Default",
+	"TK_Do",
+	"TK_Else",
+	"TK_Event",
+	"TK_Eventdef",
+	"TK_For",
+	"TK_Funcdef",
+	"TK_If",
+	"TK_Int",
+	"TK_Mainloop",
+	"TK_Onenter",
+	"TK_Onexit",
+	"TK_State",
+	"TK_Switch",
+	"TK_Str",
+	"TK_Using",
+	"TK_Var",
+	"TK_Void",
+	"TK_While",
+	"TK_True",
+	"TK_False",
+	"TK_Enum",
+	"TK_Func",
+	"TK_Return",
+	"TK_Symbol",
+	"TK_Number",
+	"TK_String",
+	"TK_Module",
+	"TK_Any",
+};
+
+inline const char* getETokenTypeString (ETokenType a)
+{
+	return g_ETokenTypeNames[a];
+}
+
+static const char* g_DataTypeNames[] =
+{
+	"TYPE_Unknown",
+	"TYPE_Void",
+	"TYPE_Int",
+	"TYPE_String",
+	"TYPE_Bool",
+};
+
+inline const char* getDataTypeString (DataType a)
+{
+	return g_DataTypeNames[a];
+}
@@ -37,8 +37,4 @@ struct EventDefinition
 	int number;
 };
 
-void addEvent (EventDefinition* e);
-EventDefinition* findEventByIndex (int idx);
-EventDefinition* findEventByName (String a);
-
 #endif // BOTC_EVENTS_H
@@ -1,6 +1,8 @@
 #include "expression.h"
 #include "dataBuffer.h"
+#include "emitter.h"
 #include "lexer.h"
+#include "compilerContext.h"
 
 struct OperatorInfo
 {
@@ -42,60 +44,136 @@ Expression::Expression (BotscriptParser* parser, Lexer* lx, DataType reqtype) :
 	m_lexer (lx),
 	m_type (reqtype)
 {
-	ExpressionSymbol* sym;
+	m_result = parseOperand();
 
-	while ((sym = parseSymbol()) != null)
-		m_symbols << sym;
-
-	// If we were unable to get any expression symbols, something's wonky with
-	// the script. Report an error. mBadTokenText is set to the token that
-	// ParseSymbol ends at when it returns false.
-	if (m_symbols.isEmpty())
+	// If we were unable to get even one operand, something's wonky with the
+	// script. Report an error. m_badTokenText is set to the token that
+	// parseOperand ends at when it returns null.
+	if (m_result == null)
 		error ("unknown identifier '%1'", m_badTokenText);
 
-	adjustOperators();
-	verify();
-	evaluate();
+	m_result = parseOperators (m_result, AnyPriority);
 }
 
 // =============================================================================
 //
 Expression::~Expression()
 {
-	for (ExpressionSymbol* sym : m_symbols)
-		delete sym;
+	// The value itself belongs to the arena, but its buffer does not.
+	m_parser->context()->recycleBuffer (m_result->buffer());
 }
 
 // =============================================================================
 //
-// Try to parse an expression symbol (i.e. an OPER_erator or OPER_erand or a colon)
-// from the lexer.
+// Parses binary and ternary operators, and their operands, as long as their
+// priority is below @limit. @lhs is the operand before the first operator.
+// Operators of equal priority are applied from left to right, which is why
+// their right-hand operands are only allowed operators of a lower priority.
+//
+ExpressionValue* Expression::parseOperators (ExpressionValue* lhs, int limit)
+{
+	int id;
+
+	while ((id = peekBinaryOperator()) != -1 && g_Operators[id].priority < limit)
+	{
+		const OperatorInfo& info = g_Operators[id];
+		ExpressionValue* values[3] = { lhs, null, null };
+		m_lexer->skip();
+
+		if (m_type == TYPE_String)
+			error ("cannot perform operations on strings");
+
+		values[1] = parseSubExpression (info.priority);
+
+		if (info.numoperands == 3)
+		{
+			m_lexer->mustGetNext (TK_Colon);
+			values[2] = parseSubExpression (info.priority);
+		}
+
+		lhs = evaluateOperator ((ExpressionOperatorType) id, values);
+	}
+
+	return lhs;
+}
+
+// =============================================================================
 //
-ExpressionSymbol* Expression::parseSymbol()
+ExpressionValue* Expression::parseSubExpression (int limit)
 {
-	int pos = m_lexer->position();
+	ExpressionValue* operand = parseOperand();
+
+	if (operand == null)
+		error ("malformed expression");
+
+	return parseOperators (operand, limit);
+}
+
+// =============================================================================
+//
+// If the next token is an operator that goes between two operands, returns its
+// index into g_Operators. Otherwise returns -1.
+//
+int Expression::peekBinaryOperator()
+{
+	Lexer::TokenInfo next;
+
+	if (m_lexer->peekNext (&next) == false)
+		return -1;
+
+	for (const OperatorInfo& info : g_Operators)
+		if (info.numoperands > 1 && info.token == next.type)
+			return &info - &g_Operators[0];
+
+	return -1;
+}
+
+// =============================================================================
+//
+// Try to parse an operand, along with any unary operators before it, from the
+// lexer. Returns null if there is none.
+//
+ExpressionValue* Expression::parseOperand()
+{
+	Lexer::Checkpoint checkpoint (m_lexer);
 	ExpressionValue* op = null;
 
-	if (m_lexer->next (TK_Colon))
-		return new ExpressionColon;
+	// Check for unary operators. Since they come before an operand, a minus
+	// sign here cannot be a subtraction.
+	for (const OperatorInfo& info : g_Operators)
+	{
+		if (info.numoperands == 1 && m_lexer->next (info.token))
+		{
+			if (m_type == TYPE_String)
+				error ("cannot perform operations on strings");
+
+			ExpressionValue* values[1] = { parseOperand() };
+
+			if (values[0] == null)
+				error ("malformed expression");
 
-	// Check for OPER_erator
-	for (const OperatorInfo& op : g_Operators)
-		if (m_lexer->next (op.token))
-			return new ExpressionOperator ((ExpressionOperatorType) (&op - &g_Operators[0]));
+			return evaluateOperator ((ExpressionOperatorType) (&info - &g_Operators[0]), values);
+		}
+	}
 
 	// Check sub-expression
 	if (m_lexer->next (TK_ParenStart))
 	{
-		Expression expr (m_parser, m_lexer, m_type);
+		op = parseSubExpression (AnyPriority);
 		m_lexer->mustGetNext (TK_ParenEnd);
-		return expr.getResult()->clone();
+		return op;
 	}
 
-	op = new ExpressionValue (m_type);
+	op = m_parser->context()->arena().make<ExpressionValue> (m_type);
 
 	// Check function
-	if (CommandInfo* comm = findCommandByName (m_lexer->peekNextString()))
+	Lexer::TokenInfo next;
+	CommandInfo* comm = null;
+
+	if (m_lexer->peekNext (&next) && next.type == TK_Symbol)
+		comm = m_parser->context()->names().info (next.name).command;
+
+	if (comm != null)
 	{
 		m_lexer->skip();
 
@@ -110,7 +188,8 @@ ExpressionSymbol* Expression::parseSymbol()
 	if (m_lexer->next (TK_DollarSign))
 	{
 		m_lexer->mustGetNext (TK_Symbol);
-		Variable* var = m_parser->findVariable (getTokenString());
+		Lexer::TokenInfo tok = m_lexer->token();
+		Variable* var = m_parser->findVariable (tok.name, tok.text);
 
 		if (var == null)
 			error ("unknown variable %1", getTokenString());
@@ -123,10 +202,8 @@ ExpressionSymbol* Expression::parseSymbol()
 		{
 			m_lexer->mustGetNext (TK_BracketStart);
 			Expression expr (m_parser, m_lexer, TYPE_Int);
-			expr.getResult()->convertToBuffer();
-			DataBuffer* buf = expr.getResult()->buffer()->clone();
-			buf->writeDWord (DH_PushGlobalArray);
-			buf->writeDWord (var->index);
+			DataBuffer* buf = expr.getResult()->takeBuffer (m_parser->context());
+			Emitter (buf).emit<DH_PushGlobalArray> (var->index);
 			op->setBuffer (buf);
 			m_lexer->mustGetNext (TK_BracketEnd);
 		}
@@ -134,14 +211,13 @@ ExpressionSymbol* Expression::parseSymbol()
 			op->setValue (var->value);
 		else
 		{
-			DataBuffer* buf = new DataBuffer (8);
+			DataBuffer* buf = m_parser->context()->makeBuffer();
 
 			if (var->IsGlobal())
-				buf->writeDWord (DH_PushGlobalVar);
+				Emitter (buf).emit<DH_PushGlobalVar> (var->index);
 			else
-				buf->writeDWord (DH_PushLocalVar);
+				Emitter (buf).emit<DH_PushLocalVar> (var->index);
 
-			buf->writeDWord (var->index);
 			op->setBuffer (buf);
 		}
 
@@ -172,7 +248,7 @@ ExpressionSymbol* Expression::parseSymbol()
 		{
 			if (m_lexer->next (TK_Number))
 			{
-				op->setValue (getTokenString().toLong());
+				op->setValue (m_lexer->token().number);
 				return op;
 			}
 		}
@@ -181,292 +257,98 @@ ExpressionSymbol* Expression::parseSymbol()
 		{
 			if (m_lexer->next (TK_String))
 			{
-				op->setValue (getStringTableIndex (getTokenString()));
-				return op;
-			}
-		}
-	}
-
-	m_badTokenText = m_lexer->token()->text;
-	m_lexer->setPosition (pos);
-	delete op;
-	return null;
-}
-
-// =============================================================================
-//
-// The symbol parsing process only does token-based checking for OPER_erators.
-// Thus ALL minus OPER_erators are actually unary minuses simply because both
-// have TK_Minus as their token and the unary minus is prior to the binary minus
-// in the OPER_erator table. Now that we have all symbols present, we can
-// correct cases like this.
-//
-void Expression::adjustOperators()
-{
-	for (auto it = m_symbols.begin() + 1; it != m_symbols.end(); ++it)
-	{
-		if ((*it)->type() != EXPRSYM_Operator)
-			continue;
-
-		ExpressionOperator* op = static_cast<ExpressionOperator*> (*it);
-
-		// Unary minus with a value as the previous symbol cannot really be
-		// unary; replace with binary minus.
-		if (op->id() == OPER_UnaryMinus && (*(it - 1))->type() == EXPRSYM_Value)
-			op->setID (OPER_Subtraction);
-	}
-}
-
-// =============================================================================
-//
-// Verifies a single value. Helper function for Expression::verify.
-//
-void Expression::tryVerifyValue (bool* verified, SymbolList::Iterator it)
-{
-	// If it's an unary OPER_erator we skip to its value. The actual OPER_erator will
-	// be verified separately.
-	if ((*it)->type() == EXPRSYM_Operator &&
-			g_Operators[static_cast<ExpressionOperator*> (*it)->id()].numoperands == 1)
-	{
-		++it;
-	}
-
-	int i = it - m_symbols.begin();
-
-	// Ensure it's an actual value
-	if ((*it)->type() != EXPRSYM_Value)
-		error ("malformed expression (symbol #%1 is not a value)", i);
-
-	verified[i] = true;
-}
-
-// =============================================================================
-//
-// Ensures the expression is valid and well-formed and not OMGWTFBBQ. Throws an
-// error if this is not the case.
-//
-void Expression::verify()
-{
-	if (m_symbols.size() == 1)
-	{
-		if (m_symbols[0]->type() != EXPRSYM_Value)
-			error ("bad expression");
-
-		return;
-	}
-
-	if (m_type == TYPE_String)
-		error ("Cannot perform OPER_erations on strings");
-
-	bool* verified = new bool[m_symbols.size()];
-	memset (verified, 0, m_symbols.size() * sizeof (decltype (*verified)));
-	const auto last = m_symbols.end() - 1;
-	const auto first = m_symbols.begin();
-
-	for (auto it = m_symbols.begin(); it != m_symbols.end(); ++it)
-	{
-		int i = (it - first);
-
-		if ((*it)->type() != EXPRSYM_Operator)
-			continue;
-
-		ExpressionOperator* op = static_cast<ExpressionOperator*> (*it);
-		int numoperands = g_Operators[op->id()].numoperands;
-
-		switch (numoperands)
-		{
-			case 1:
-			{
-				// Ensure that:
-				// -	unary OPER_erator is not the last symbol
-				// -	unary OPER_erator is succeeded by a value symbol
-				// -	neither symbol overlaps with something already verified
-				tryVerifyValue (verified, it + 1);
-
-				if (it == last || verified[i] == true)
-					error ("malformed expression");
-
-				verified[i] = true;
-				break;
-			}
-
-			case 2:
-			{
-				// Ensure that:
-				// -	binary OPER_erator is not the first or last symbol
-				// -	is preceded and succeeded by values
-				// -	none of the three tokens are already verified
-				//
-				// Basically similar logic as above.
-				if (it == first || it == last || verified[i] == true)
-					error ("malformed expression");
-
-				tryVerifyValue (verified, it + 1);
-				tryVerifyValue (verified, it - 1);
-				verified[i] = true;
-				break;
-			}
-
-			case 3:
-			{
-				// Ternary OPER_erator case. This goes a bit nuts.
-				// This time we have the following:
-				//
-				// (VALUE) ? (VALUE) : (VALUE)
-				//         ^
-				// --------/ we are here
-				//
-				// Check that the:
-				// -	questionmark OPER_erator is not misplaced (first or last)
-				// -	the value behind the OPER_erator (-1) is valid
-				// -	the value after the OPER_erator (+1) is valid
-				// -	the value after the colon (+3) is valid
-				// -	none of the five tokens are verified
-				//
-				tryVerifyValue (verified, it - 1);
-				tryVerifyValue (verified, it + 1);
-				tryVerifyValue (verified, it + 3);
-
-				if (it == first ||
-					it >= m_symbols.end() - 3 ||
-					verified[i] == true ||
-					verified[i + 2] == true ||
-					(*(it + 2))->type() != EXPRSYM_Colon)
+				if (m_parser->context()->isDiscarding())
 				{
-					error ("malformed expression");
+					m_parser->context()->stringTable().check (getTokenString());
+					op->setValue (0);
 				}
+				else
+					op->setValue (m_parser->context()->stringTable().getIndex (getTokenString()));
 
-				verified[i] = true;
-				verified[i + 2] = true;
-				break;
+				return op;
 			}
-
-			default:
-				error ("WTF OPER_erator with %1 OPER_erands", numoperands);
 		}
 	}
 
-	for (int i = 0; i < m_symbols.size(); ++i)
-		if (verified[i] == false)
-			error ("malformed expression: expr symbol #%1 is was left unverified", i);
-
-	delete verified;
-}
-
-
-// =============================================================================
-//
-// Which operator to evaluate?
-//
-Expression::SymbolList::Iterator Expression::findPrioritizedOperator()
-{
-	SymbolList::Iterator	best = m_symbols.end();
-	int						bestpriority = __INT_MAX__;
-
-	for (SymbolList::Iterator it = m_symbols.begin(); it != m_symbols.end(); ++it)
-	{
-		if ((*it)->type() != EXPRSYM_Operator)
-			continue;
-
-		ExpressionOperator* op = static_cast<ExpressionOperator*> (*it);
-		const OperatorInfo* info = &g_Operators[op->id()];
-
-		if (info->priority < bestpriority)
-		{
-			best = it;
-			bestpriority = info->priority;
-		}
-	}
-
-	return best;
+	m_badTokenText = m_lexer->token().text;
+	checkpoint.rewind();
+	return null;
 }
 
 // =============================================================================
 //
-// Process the given OPER_erator and values into a new value.
+// Applies the given operator to @values, which are as many as the operator has
+// operands. The result takes the place of the first value, and the others are
+// left unused in the arena.
 //
-ExpressionValue* Expression::evaluateOperator (const ExpressionOperator* op,
-											   const List<ExpressionValue*>& values)
+ExpressionValue* Expression::evaluateOperator (ExpressionOperatorType id, ExpressionValue* values[])
 {
-	const OperatorInfo* info = &g_Operators[op->id()];
+	const OperatorInfo* info = &g_Operators[id];
+	ExpressionValue* result = values[0];
 	bool isconstexpr = true;
-	ASSERT_EQ (values.size(), info->numoperands)
 
-	for (ExpressionValue* val : values)
+	for (int i = 0; i < info->numoperands; ++i)
 	{
-		if (val->isConstexpr() == false)
+		if (values[i]->isConstexpr() == false)
 		{
 			isconstexpr = false;
 			break;
 		}
 	}
 
-	// If not all of the values are constant expressions, none of them shall be.
-	if (isconstexpr == false)
-		for (ExpressionValue* val : values)
-			val->convertToBuffer();
-
-	ExpressionValue* newval = new ExpressionValue (m_type);
-
 	if (isconstexpr == false)
 	{
 		// This is not a constant expression so we'll have to use databuffers
 		// to convey the expression to bytecode. Actual value cannot be evaluated
-		// until Zandronum processes it at run-time.
-		newval->setBuffer (new DataBuffer);
+		// until Zandronum processes it at run-time. If not all of the values are
+		// constant expressions, none of them shall be.
+		for (int i = 0; i < info->numoperands; ++i)
+			values[i]->convertToBuffer (m_parser->context());
 
-		if (op->id() == OPER_Ternary)
+		DataBuffer* buf = result->buffer();
+
+		if (id == OPER_Ternary)
 		{
-			// There isn't a dataheader for ternary OPER_erator. Instead, we use DH_IfNotGoto
+			// There isn't a dataheader for ternary operator. Instead, we use DH_IfNotGoto
 			// to create an "if-block" inside an expression.
 			// Behold, big block of writing madness! :P
 			//
-			DataBuffer* buf = newval->buffer();
-			DataBuffer* b0 = values[0]->buffer();
 			DataBuffer* b1 = values[1]->buffer();
 			DataBuffer* b2 = values[2]->buffer();
-			ByteMark* mark1 = buf->addMark (""); // start of "else" case
-			ByteMark* mark2 = buf->addMark (""); // end of expression
-			buf->mergeAndDestroy (b0);
-			buf->writeDWord (DH_IfNotGoto); // if the first OPER_erand (condition)
-			buf->addReference (mark1); // didn't eval true, jump into mark1
-			buf->mergeAndDestroy (b1); // otherwise, perform second OPER_erand (true case)
-			buf->writeDWord (DH_Goto); // afterwards, jump to the end, which is
-			buf->addReference (mark2); // marked by mark2.
+			ByteMark mark1 = buf->addMark(); // start of "else" case
+			ByteMark mark2 = buf->addMark(); // end of expression
+			Emitter (buf).emit<DH_IfNotGoto> (mark1); // if the condition didn't eval true, jump into mark1
+			buf->mergeAndDestroy (b1); // otherwise, perform second operand (true case)
+			Emitter (buf).emit<DH_Goto> (mark2); // afterwards, jump to the end, marked by mark2
 			buf->adjustMark (mark1); // move mark1 at the end of the true case
-			buf->mergeAndDestroy (b2); // perform third OPER_erand (false case)
+			buf->mergeAndDestroy (b2); // perform third operand (false case)
 			buf->adjustMark (mark2); // move the ending mark2 here
-
-			for (int i = 0; i < 3; ++i)
-				values[i]->setBuffer (null);
 		}
 		else
 		{
-			// Generic case: write all arguments and apply the OPER_erator's
+			// Generic case: write all arguments and apply the operator's
 			// data header.
-			for (ExpressionValue* val : values)
-			{
-				newval->buffer()->mergeAndDestroy (val->buffer());
-
-				// Null the pointer out so that the value's destructor will not
-				// attempt to double-free it.
-				val->setBuffer (null);
-			}
+			for (int i = 1; i < info->numoperands; ++i)
+				buf->mergeAndDestroy (values[i]->buffer());
 
-			newval->buffer()->writeDWord (info->header);
+			Emitter (buf).emit (info->header);
 		}
+
+		// The other values' buffers were merged into the result and destroyed.
+		for (int i = 1; i < info->numoperands; ++i)
+			values[i]->setBuffer (null);
 	}
 	else
 	{
 		// We have a constant expression. We know all the values involved and
 		// can thus compute the result of this expression on compile-time.
-		List<int> nums;
-		int a;
+		int nums[3];
+		int a = 0;
 
-		for (ExpressionValue* val : values)
-			nums << val->value();
+		for (int i = 0; i < info->numoperands; ++i)
+			nums[i] = values[i]->value();
 
-		switch (op->id())
+		switch (id)
 		{
 			case OPER_Addition:				a = nums[0] + nums[1];					break;
 			case OPER_Subtraction:			a = nums[0] - nums[1];					break;
@@ -507,141 +389,53 @@ ExpressionValue* Expression::evaluateOperator (const ExpressionOperator* op,
 			}
 		}
 
-		newval->setValue (a);
-	}
-
-	// The new value has been generated. We don't need the old stuff anymore.
-	for (ExpressionValue* val : values)
-		delete val;
-
-	delete op;
-	return newval;
-}
-
-// =============================================================================
-//
-ExpressionValue* Expression::evaluate()
-{
-	SymbolList::Iterator it;
-
-	while ((it = findPrioritizedOperator()) != m_symbols.end())
-	{
-		int i = it - m_symbols.begin();
-		List<SymbolList::Iterator> OPER_erands;
-		ExpressionOperator* op = static_cast<ExpressionOperator*> (*it);
-		const OperatorInfo* info = &g_Operators[op->id()];
-		int lower, upper; // Boundaries of area to replace
-
-		switch (info->numoperands)
-		{
-			case 1:
-			{
-				lower = i;
-				upper = i + 1;
-				OPER_erands << it + 1;
-				break;
-			}
-
-			case 2:
-			{
-				lower = i - 1;
-				upper = i + 1;
-				OPER_erands << it - 1
-				         << it + 1;
-				break;
-			}
-
-			case 3:
-			{
-				lower = i - 1;
-				upper = i + 3;
-				OPER_erands << it - 1
-				         << it + 1
-				         << it + 3;
-				break;
-			}
-
-			default:
-				error ("WTF bad expression with %1 operands", info->numoperands);
-		}
-
-		List<ExpressionValue*> values;
-
-		for (auto it : OPER_erands)
-			values << static_cast<ExpressionValue*> (*it);
-
-		// Note: @op and all of @values are invalid after this call.
-		ExpressionValue* newvalue = evaluateOperator (op, values);
-
-		for (int i = upper; i >= lower; --i)
-			m_symbols.removeAt (i);
-
-		m_symbols.insert (lower, newvalue);
+		result->setValue (a);
 	}
 
-	ASSERT_EQ (m_symbols.size(), 1)
-	ASSERT_EQ (m_symbols.first()->type(), EXPRSYM_Value)
-	ExpressionValue* val = static_cast<ExpressionValue*> (m_symbols.first());
-	return val;
+	return result;
 }
 
 // =============================================================================
 //
 ExpressionValue* Expression::getResult()
 {
-	return static_cast<ExpressionValue*> (m_symbols.first());
+	return m_result;
 }
 
 // =============================================================================
 //
 String Expression::getTokenString()
 {
-	return m_lexer->token()->text;
+	return m_lexer->token().text;
 }
 
-// =============================================================================
-//
-ExpressionOperator::ExpressionOperator (ExpressionOperatorType id) :
-	ExpressionSymbol (EXPRSYM_Operator),
-	m_id (id) {}
-
 // =============================================================================
 //
 ExpressionValue::ExpressionValue (DataType valuetype) :
-	ExpressionSymbol (EXPRSYM_Value),
 	m_buffer (null),
 	m_valueType (valuetype) {}
 
 // =============================================================================
 //
-ExpressionValue::~ExpressionValue()
-{
-	delete m_buffer;
-}
-
-// =============================================================================
-//
-void ExpressionValue::convertToBuffer()
+void ExpressionValue::convertToBuffer (CompilerContext* context)
 {
 	if (isConstexpr() == false)
 		return;
 
-	setBuffer (new DataBuffer);
+	setBuffer (context->makeBuffer());
 
 	switch (m_valueType)
 	{
 		case TYPE_Bool:
 		case TYPE_Int:
-			buffer()->writeDWord (DH_PushNumber);
-			buffer()->writeDWord (abs (value()));
+			Emitter (buffer()).emit<DH_PushNumber> (abs (value()));
 
 			if (value() < 0)
-				buffer()->writeDWord (DH_UnaryMinus);
+				Emitter (buffer()).emit<DH_UnaryMinus>();
 			break;
 
 		case TYPE_String:
-			buffer()->writeDWord (DH_PushStringIndex);
-			buffer()->writeDWord (value());
+			Emitter (buffer()).emit<DH_PushStringIndex> (value());
 			break;
 
 		case TYPE_Void:
@@ -649,3 +443,15 @@ void ExpressionValue::convertToBuffer()
 			error ("WTF: tried to convert bad expression value type %1 to buffer", m_valueType);
 	}
 }
+
+// =============================================================================
+//
+// Converts the value to a buffer and hands the buffer over to the caller.
+//
+DataBuffer* ExpressionValue::takeBuffer (CompilerContext* context)
+{
+	convertToBuffer (context);
+	DataBuffer* buf = buffer();
+	setBuffer (null);
+	return buf;
+}
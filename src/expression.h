@@ -1,11 +1,10 @@
 #ifndef BOTC_EXPRESSION_H
 #define BOTC_EXPRESSION_H
+#include <climits>
 #include "parser.h"
 
 class DataBuffer;
-class ExpressionSymbol;
 class ExpressionValue;
-class ExpressionOperator;
 
 // =============================================================================
 //
@@ -34,66 +33,38 @@ named_enum ExpressionOperatorType
 	OPER_Ternary,
 };
 
-// =============================================================================
-//
-enum ExpressionSymbolType
-{
-	EXPRSYM_Operator,
-	EXPRSYM_Value,
-	EXPRSYM_Colon,
-};
-
 class Expression final
 {
 	public:
-		using SymbolList = List<ExpressionSymbol*>;
-
 		Expression (BotscriptParser* parser, Lexer* lx, DataType reqtype);
 		~Expression();
 		ExpressionValue*		getResult();
 
 	private:
+		//! Priority limit which lets every operator through
+		enum { AnyPriority = INT_MAX };
+
 		BotscriptParser*		m_parser;
 		Lexer*					m_lexer;
-		SymbolList				m_symbols;
+		ExpressionValue*		m_result;
 		DataType				m_type;
 		String					m_badTokenText;
 
-		ExpressionValue*		evaluate(); // Process the expression and yield a result
-		ExpressionSymbol*		parseSymbol();
+		ExpressionValue*		parseOperand();
+		ExpressionValue*		parseOperators (ExpressionValue* lhs, int limit);
+		ExpressionValue*		parseSubExpression (int limit);
+		int						peekBinaryOperator();
 		String					getTokenString();
-		void					adjustOperators();
-		void					verify(); // Ensure the expr is valid
-		void					tryVerifyValue (bool* verified, SymbolList::Iterator it);
-		ExpressionValue*		evaluateOperator (const ExpressionOperator* op,
-												  const List<ExpressionValue*>& values);
-		SymbolList::Iterator	findPrioritizedOperator();
+		ExpressionValue*		evaluateOperator (ExpressionOperatorType id, ExpressionValue* values[]);
 };
 
 // =============================================================================
 //
-class ExpressionSymbol
-{
-	public:
-		ExpressionSymbol (ExpressionSymbolType type) :
-			m_type (type) {}
-
-	PROPERTY (private, ExpressionSymbolType, type, setType, STOCK_WRITE)
-};
-
-// =============================================================================
-//
-class ExpressionOperator final : public ExpressionSymbol
-{
-	PROPERTY (public, ExpressionOperatorType, id, setID, STOCK_WRITE)
-
-	public:
-		ExpressionOperator (ExpressionOperatorType id);
-};
-
-// =============================================================================
+// An operand of an expression, or the result of applying operators to them.
+// Constant values are folded as the expression is parsed, so a value is either
+// a constant or a buffer of the bytecode which computes it.
 //
-class ExpressionValue final : public ExpressionSymbol
+class ExpressionValue final
 {
 	PROPERTY (public, int,			value,		setValue,		STOCK_WRITE)
 	PROPERTY (public, DataBuffer*,	buffer,		setBuffer,		STOCK_WRITE)
@@ -101,14 +72,9 @@ class ExpressionValue final : public ExpressionSymbol
 
 	public:
 		ExpressionValue (DataType valuetype);
-		~ExpressionValue();
-
-		void					convertToBuffer();
 
-		inline ExpressionValue* clone() const
-		{
-			return new ExpressionValue (*this);
-		}
+		void					convertToBuffer (CompilerContext* context);
+		DataBuffer*				takeBuffer (CompilerContext* context);
 
 		inline bool isConstexpr() const
 		{
@@ -116,17 +82,4 @@ class ExpressionValue final : public ExpressionSymbol
 		}
 };
 
-// =============================================================================
-//
-// This class represents a ":" in the expression. It serves as the colon for the
-// ternary ?: OPER_erator. It's not an OPER_erand nor is an OPER_erator, nor can we just
-// skip it so it is its own thing here.
-//
-class ExpressionColon final : public ExpressionSymbol
-{
-	public:
-		ExpressionColon() :
-			ExpressionSymbol (EXPRSYM_Colon) {}
-};
-
 #endif // BOTC_EXPRESSION_H
@@ -30,6 +30,7 @@
 #include "main.h"
 #include "format.h"
 #include "lexer.h"
+#include "compilerContext.h"
 
 //
 // Throws an error while formatting the string
@@ -103,19 +104,19 @@ String formatArgs (const String& fmtstr, const std::vector<String>& args)
 }
 
 //
-// Throws a runtime error with the message @msg. If a lexer is active, its
-// position is printed as well.
+// Throws a runtime error with the message @msg. If the current compilation of
+// this thread has a lexer, its position is printed as well.
 //
 void error (const String& msg)
 {
-	Lexer* lx = Lexer::getCurrentLexer();
+	CompilerContext* context = CompilerContext::current();
+	Lexer* lx = (context != null) ? context->lexer() : null;
 	String fileinfo;
+	String file;
+	int line, column;
 
-	if (lx != null && lx->hasValidToken())
-	{
-		Lexer::TokenInfo* tk = lx->token();
-		fileinfo = format ("%1:%2:%3: ", tk->file, tk->line, tk->column);
-	}
+	if (lx != null && lx->getErrorPosition (&file, &line, &column))
+		fileinfo = format ("%1:%2:%3: ", file, line, column);
 
-	throw std::runtime_error (fileinfo + msg);
+	throw std::runtime_error ((fileinfo + msg).stdString());
 }
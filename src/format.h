@@ -29,6 +29,7 @@
 #ifndef BOTC_FORMAT_H
 #define BOTC_FORMAT_H
 
+#include <vector>
 #include "string.h"
 #include "list.h"
 
@@ -36,6 +37,7 @@ class FormatArgument
 {
 public:
 	FormatArgument (const String& a) : m_text (a) {}
+	FormatArgument (const StringView& a) : m_text (a.toString()) {}
 	FormatArgument (char a) : m_text (a) {}
 	FormatArgument (int a) : m_text (String::fromNumber (a)) {}
 	FormatArgument (long a) : m_text (String::fromNumber (a)) {}
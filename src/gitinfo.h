@@ -0,0 +1,9 @@
+// 0 <unknown branch>
+//
+// This file was automatically generated by the
+// updaterevision tool. Do not edit by hand.
+
+#define GIT_DESCRIPTION "<unknown version>"
+#define GIT_HASH "0"
+#define GIT_TIME ""
+#define GIT_BRANCH "<unknown branch>"
@@ -0,0 +1,180 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <sys/stat.h>
+
+#ifndef _WIN32
+# include <dirent.h>
+#endif
+
+#include "includeResolver.h"
+
+// =============================================================================
+//
+IncludeResolver::IncludeResolver() :
+	m_numIds (0) {}
+
+// =============================================================================
+//
+void IncludeResolver::addSearchDirectory (const String& path)
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+	m_searchDirectories << path;
+}
+
+// =============================================================================
+//
+int IncludeResolver::resolve (const String& fileName, String* path)
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+	auto it = m_resolutions.find (fileName);
+
+	if (it == m_resolutions.end())
+	{
+		StringList candidates;
+		candidates << fileName;
+
+		if (fileName[0] != '/')
+		{
+			for (const String& directory : m_searchDirectories)
+				candidates << directory + "/" + fileName;
+		}
+
+		Resolution resolution;
+		resolution.id = -1;
+
+		for (const String& candidate : candidates)
+		{
+			const FileInfo& info = lookUpFile (candidate);
+
+			if (info.isFile == false)
+				continue;
+
+			auto id = m_ids.find (info.identity);
+
+			if (id == m_ids.end())
+				id = m_ids.insert (std::make_pair (info.identity, m_numIds++)).first;
+
+			resolution.path = candidate;
+			resolution.id = id->second;
+			break;
+		}
+
+		it = m_resolutions.insert (std::make_pair (fileName, resolution)).first;
+	}
+
+	*path = it->second.path;
+	return it->second.id;
+}
+
+// =============================================================================
+//
+int IncludeResolver::makeUniqueId()
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+	return m_numIds++;
+}
+
+// =============================================================================
+//
+const IncludeResolver::DirectoryInfo& IncludeResolver::listDirectory (const String& path)
+{
+	auto it = m_directories.find (path);
+
+	if (it != m_directories.end())
+		return it->second;
+
+	DirectoryInfo& info = m_directories[path];
+	info.isListed = false;
+
+#ifndef _WIN32
+	DIR* dir = opendir (path);
+
+	if (dir != null)
+	{
+		while (dirent* entry = readdir (dir))
+			info.names.insert (entry->d_name);
+
+		closedir (dir);
+		info.isListed = true;
+	}
+#endif
+
+	return info;
+}
+
+// =============================================================================
+//
+// Looks at @path. The directory it is in is listed first, so that names that
+// aren't there are known not to be files without stat'ing each of them.
+//
+const IncludeResolver::FileInfo& IncludeResolver::lookUpFile (const String& path)
+{
+	auto it = m_files.find (path);
+
+	if (it != m_files.end())
+		return it->second;
+
+	FileInfo& info = m_files[path];
+	info.isFile = false;
+	size_t slash = path.stdString().rfind ('/');
+	String directory;
+	String name;
+
+	if (slash == std::string::npos)
+	{
+		directory = ".";
+		name = path;
+	}
+	else
+	{
+		directory = (slash == 0) ? String ("/") : path.mid (0, slash);
+		name = path.mid (slash + 1);
+	}
+
+	const DirectoryInfo& dir = listDirectory (directory);
+
+	if (dir.isListed && dir.names.find (name) == dir.names.end())
+		return info;
+
+	struct stat st;
+
+	if (stat (path, &st) != 0 || S_ISREG (st.st_mode) == false)
+		return info;
+
+	info.isFile = true;
+
+#ifndef _WIN32
+	info.identity = format ("%1:%2", (long) st.st_dev, (long) st.st_ino);
+#else
+	// Inodes don't identify files on Windows, the paths will have to do
+	info.identity = path;
+#endif
+
+	return info;
+}
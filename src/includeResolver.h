@@ -0,0 +1,96 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_INCLUDE_RESOLVER_H
+#define BOTC_INCLUDE_RESOLVER_H
+
+#include <map>
+#include <mutex>
+#include <set>
+#include "main.h"
+
+// =============================================================================
+//
+// Finds the files named by #include directives. A file is looked for as named
+// first and then in each search directory in turn. Directory listings and file
+// identities are looked up just once per run, so that resolving the same names
+// over and over again doesn't hit the file system.
+//
+// Each distinct file gets an id of its own. Files are told apart by their
+// device and inode, so the same file reached through different paths (e.g.
+// through a symbolic link or a search directory) gets the same id.
+//
+class IncludeResolver
+{
+public:
+	IncludeResolver();
+
+	void	addSearchDirectory (const String& path);
+
+	// Finds the file @fileName refers to. Returns its id and stores its path
+	// to @path, or returns -1 if there is no such file.
+	int		resolve (const String& fileName, String* path);
+
+	// Returns an id no file has, for a file that can only be opened by name.
+	int		makeUniqueId();
+
+private:
+	struct Resolution
+	{
+		String		path;
+		int			id;
+	};
+
+	// The names in a directory. If the directory could not be listed, it is
+	// not known what is in it and the files in it have to be looked at one
+	// by one.
+	struct DirectoryInfo
+	{
+		bool				isListed;
+		std::set<String>	names;
+	};
+
+	struct FileInfo
+	{
+		bool		isFile;
+		String		identity;
+	};
+
+	std::mutex						m_mutex;
+	StringList						m_searchDirectories;
+	std::map<String, Resolution>	m_resolutions;
+	std::map<String, DirectoryInfo>	m_directories;
+	std::map<String, FileInfo>		m_files;
+	std::map<String, int>			m_ids;
+	int								m_numIds;
+
+	const DirectoryInfo&	listDirectory (const String& path);
+	const FileInfo&			lookUpFile (const String& path);
+};
+
+#endif // BOTC_INCLUDE_RESOLVER_H
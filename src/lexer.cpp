@@ -26,79 +26,1298 @@
 	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include "lexer.h"
+#include "builtins.h"
+#include "module.h"
+#include "compilerContext.h"
 
-static StringList	gFileNameStack;
-static Lexer*		gMainLexer = null;
+// Set on threads that only read tokens, i.e. the lexer thread of a pipelined
+// lexer and the threads lexing files in parallel.
+static thread_local bool gIsLexerThread = false;
+
+// The file the current thread is reading a token from, if any. Errors raised
+// meanwhile are reported at that token, or at gScanningOffset within the file
+// if it is set.
+static thread_local Lexer::SourceFile* gScanningFile = null;
+static thread_local int gScanningOffset = -1;
+
+// =============================================================================
+//
+// Sets the place errors are reported at for as long as it exists.
+//
+class ScanningFileScope
+{
+public:
+	ScanningFileScope (Lexer::SourceFile* file, int offset = -1) :
+		m_file (gScanningFile),
+		m_offset (gScanningOffset)
+	{
+		gScanningFile = file;
+		gScanningOffset = offset;
+	}
+
+	~ScanningFileScope()
+	{
+		gScanningFile = m_file;
+		gScanningOffset = m_offset;
+	}
+
+private:
+	Lexer::SourceFile*	m_file;
+	int					m_offset;
+};
+
+// =============================================================================
+//
+// State shared by the threads lexing files in parallel, see lexInParallel.
+// Files are listed in @files as soon as they are opened and queued up in
+// @queue to be lexed.
+//
+struct Lexer::ParallelLexing
+{
+	std::mutex					mutex;
+	std::condition_variable		condition;
+	List<FileTokens*>			files;
+	List<FileTokens*>			queue;
+	int							numBusyThreads;
+	int							numListedFiles;
+
+	FileTokens* findFile (int id) const
+	{
+		for (FileTokens* file : files)
+		{
+			if (file->file.id == id)
+				return file;
+		}
+
+		return null;
+	}
+};
+
+// =============================================================================
+//
+Lexer::Lexer (CompilerContext* context) :
+	m_isStreaming (false),
+	m_isPipelined (false),
+	m_isCaching (true),
+	m_hasBuiltinDefinitions (false),
+	m_context (context),
+	m_firstToken (0),
+	m_firstCopiedText (0),
+	m_tokenPosition (-1),
+	m_isInputDone (true),
+	m_isSkipping (false),
+	m_numModules (0),
+	m_nextFileStart (0),
+	m_numCopiedTexts (0),
+	m_pipelineHead (0),
+	m_pipelineTail (0),
+	m_isStopping (false)
+{
+	ASSERT_EQ (context->lexer(), null);
+	context->setLexer (this);
+	m_batch.isLast = false;
+	m_receivedBatch.isLast = false;
+
+	for (TokenBatch& batch : m_pipeline)
+		batch.isLast = false;
+}
+
+// =============================================================================
+//
+Lexer::~Lexer()
+{
+	if (m_lexerThread.joinable())
+	{
+		m_isStopping = true;
+		m_lexerThread.join();
+	}
+
+	m_context->setLexer (null);
+
+	// Files may still be on their way from the lexer thread
+	for (unsigned i = m_pipelineHead; i != m_pipelineTail; ++i)
+		m_files << m_pipeline[i % PipelineSize].files;
+
+	m_files << m_batch.files;
+
+	for (unsigned i = m_pipelineHead; i != m_pipelineTail; ++i)
+		m_modules << m_pipeline[i % PipelineSize].modules;
+
+	m_modules << m_batch.modules;
+
+	for (SourceFile& file : m_files)
+		delete file.scanner;
+
+	for (Module* module : m_modules)
+		delete module;
+}
+
+// =============================================================================
+//
+// Opens @fileName for lexing. The file and its includes are tokenized right
+// away, unless the lexer is streaming or pipelined, in which case tokens are
+// only read from it as they are asked for. When pipelined, they are read in a
+// thread of their own.
+//
+void Lexer::processFile (String fileName)
+{
+	if (m_lexerThread.joinable())
+		m_lexerThread.join();
+
+	m_initialDefines = m_defines;
+
+	if (isStreaming() || isPipelined())
+	{
+		m_isInputDone = false;
+		openFile (fileName);
+
+		if (isPipelined())
+			m_lexerThread = std::thread (&Lexer::runLexerThread, this);
+	}
+	else
+		lexInParallel (fileName);
+
+	m_tokenPosition = m_firstToken - 1;
+}
+
+// =============================================================================
+//
+// Opens the file @fileName refers to and gives it its range of locations.
+//
+Lexer::SourceFile Lexer::openSourceFile (const String& fileName)
+{
+	String path;
+	int id = m_includeResolver.resolve (fileName, &path);
+
+	// If the file wasn't found, opening it by name tells why. Should that work
+	// after all (e.g. it is not a regular file), it can't be told apart from
+	// other files and just gets an id of its own.
+	if (id == -1)
+	{
+		path = fileName;
+		id = m_includeResolver.makeUniqueId();
+	}
+
+	FILE* fp = fopen (path, "r");
+
+	if (fp == null)
+		error ("couldn't open %1 for reading: %2", fileName, strerror (errno));
+
+	// The scanner holds on to its own copy or mapping of the data, so the file
+	// can be closed right away.
+	SourceFile file;
+	file.name = path;
+	file.scanner = new LexerScanner (fp);
+	file.start = m_nextFileStart;
+	file.id = id;
+	fclose (fp);
+
+	// Each file gets the locations from its start up to and including the
+	// terminating null, which is where the EOF of the file is reported.
+	if (file.scanner->getDataSize() >= UINT32_MAX - m_nextFileStart)
+	{
+		delete file.scanner;
+		error ("%1: too much source code", fileName);
+	}
+
+	m_nextFileStart += file.scanner->getDataSize() + 1;
+
+	try
+	{
+		ScanningFileScope scope (&file);
+		checkFileHeader (*file.scanner);
+	}
+	catch (...)
+	{
+		delete file.scanner;
+		throw;
+	}
+
+	return file;
+}
+
+// =============================================================================
+//
+void Lexer::openFile (const String& fileName)
+{
+	SourceFile file = openSourceFile (fileName);
+	m_batch.files << file;
+	m_openFiles << file;
+	m_includedFiles.insert (file.id);
+}
+
+// =============================================================================
+//
+// Reads the rest of a preprocessor directive after the '#' that starts it, i.e.
+// the tokens up to the end of the line, into @batch. Returns how many tokens
+// there were.
+//
+int Lexer::readDirective (LexerScanner& sc, TokenBatch& batch, SourceLocation fileStart,
+	int& numCopiedTexts)
+{
+	int numTokens = 0;
+
+	if (sc.isAtLineEnd())
+		error ("expected a preprocessor directive after '#'");
+
+	while (sc.isAtLineEnd() == false)
+	{
+		mustGetFromScanner (sc);
+		addScannedToken (batch, sc, fileStart, numCopiedTexts);
+		numTokens++;
+	}
+
+	return numTokens;
+}
+
+// =============================================================================
+//
+// Reads the tokens of a preprocessor directive. Errors are reported at the
+// token last read.
+//
+class Lexer::DirectiveReader
+{
+public:
+	DirectiveReader (SourceFile& file, const List<TokenInfo>& tokens) :
+		m_scope (&file, tokens[0].location - file.start),
+		m_file (file),
+		m_tokens (tokens),
+		m_position (0) {}
+
+	inline bool isAtEnd() const
+	{
+		return m_position == m_tokens.size();
+	}
+
+	inline ETokenType peekType() const
+	{
+		return isAtEnd() ? TK_Any : m_tokens[m_position].type;
+	}
+
+	const TokenInfo& next (ETokenType type = TK_Any)
+	{
+		if (isAtEnd())
+			error ("unexpected end of #%1", m_tokens[0].text);
+
+		const TokenInfo& tok = m_tokens[m_position++];
+		gScanningOffset = tok.location - m_file.start;
+
+		if (type != TK_Any && tok.type != type)
+			error ("expected %1, got %2", describeTokenType (type), describeToken (tok));
+
+		return tok;
+	}
+
+	void mustBeAtEnd()
+	{
+		if (isAtEnd() == false)
+			error ("unexpected %1 after #%2", describeToken (next()), m_tokens[0].text);
+	}
+
+private:
+	ScanningFileScope		m_scope;
+	SourceFile&				m_file;
+	const List<TokenInfo>&	m_tokens;
+	int						m_position;
+};
+
+// =============================================================================
+//
+void Lexer::define (const String& name, int value)
+{
+	m_defines[name] = value;
+}
+
+// =============================================================================
+//
+// Is @fileName the definitions file whose contents are built in? Including it
+// does nothing when they have been preloaded. Files are told apart by identity,
+// so the definitions file is recognized through any path that leads to it.
+//
+bool Lexer::isBuiltinFile (const String& fileName)
+{
+	if (hasBuiltinDefinitions() == false)
+		return false;
+
+	if (fileName == builtinDefinitionsFile())
+		return true;
+
+	String path;
+	int id = m_includeResolver.resolve (fileName, &path);
+	return id != -1 && id == m_includeResolver.resolve (builtinDefinitionsFile(), &path);
+}
+
+// =============================================================================
+//
+// Is there a precompiled module next to @fileName?
+//
+bool Lexer::hasModule (const String& fileName)
+{
+	String path;
+	String modulePath;
+	return m_includeResolver.resolve (fileName, &path) != -1
+		&& m_includeResolver.resolve (Module::moduleFileName (path), &modulePath) != -1;
+}
+
+// =============================================================================
+//
+// Loads the precompiled module of @fileName to be included instead of it, if
+// there is one that gives the same result. Its files are then considered
+// included and its #defines are put in effect. What was declared in the files
+// that had been included already is left out, like the files would be if the
+// script was included. Returns null if there is no module, it is out of date
+// or the file has already been included. A module that cannot be used is
+// noted, as the script is then parsed instead.
+//
+Module* Lexer::loadModule (const String& fileName)
+{
+	String path;
+	int id = m_includeResolver.resolve (fileName, &path);
+	String modulePath;
+
+	if (id == -1
+		|| m_includedFiles.find (id) != m_includedFiles.end()
+		|| m_includeResolver.resolve (Module::moduleFileName (path), &modulePath) == -1)
+	{
+		return null;
+	}
+
+	Module* module = Module::load (modulePath);
+
+	if (module == null)
+	{
+		print ("note: not using %1, as it is not a module of this version of botc\n", modulePath);
+		return null;
+	}
+
+	List<int> ids;
+	std::set<int> includedDependencies;
+	String reason;
+
+	for (int i = 0; i < module->dependencies.size(); ++i)
+	{
+		String dependencyPath;
+		ids << m_includeResolver.resolve (module->dependencies[i].path, &dependencyPath);
+
+		if (ids.last() == -1 && reason.isEmpty())
+			reason = format ("%1 cannot be found", module->dependencies[i].path);
+		elif (m_includedFiles.find (ids.last()) != m_includedFiles.end())
+			includedDependencies.insert (i);
+	}
+
+	if (reason.isEmpty())
+	{
+		if (module->hasBuiltinDefinitions != hasBuiltinDefinitions())
+			reason = format ("it was made with%1 --builtin-defs", hasBuiltinDefinitions() ? "out" : "");
+		elif (module->initialDefines != m_defines)
+			reason = "it was made with different #defines in effect";
+		elif (ids[0] != id)
+			reason = format ("it was made from another file than %1", path);
+		elif (module->isUpToDate() == false)
+			reason = "it is out of date";
+	}
+
+	if (reason.isEmpty() == false)
+	{
+		print ("note: not using %1, as %2\n", modulePath, reason);
+		delete module;
+		return null;
+	}
+
+	for (int dependencyId : ids)
+		m_includedFiles.insert (dependencyId);
+
+	module->leaveOut (includedDependencies);
+
+	m_defines = module->defines;
+	return module;
+}
+
+// =============================================================================
+//
+// Carries out the preprocessor directive made of @tokens, which is in @file.
+// Within code that is left out, only the conditional directives are looked at
+// and only to keep track of where the code ends. Returns true if the directive
+// is an #include, with the name of the file to include in @includedFile. The
+// built-in definitions file is not included at all.
+//
+bool Lexer::processDirective (SourceFile& file, const List<TokenInfo>& tokens,
+	String* includedFile)
+{
+	DirectiveReader reader (file, tokens);
+	String name = reader.next().text;
+
+	if (name == "if" || name == "ifdef" || name == "ifndef")
+	{
+		Condition condition;
+		condition.name = name;
+		condition.location = tokens[0].location;
+		condition.wasSkipping = m_isSkipping;
+		condition.hasBeenTrue = true;
+		condition.hasElse = false;
+
+		if (m_isSkipping == false)
+		{
+			if (name == "if")
+				condition.hasBeenTrue = evaluateExpression (reader) != 0;
+			else
+			{
+				bool isDefined = m_defines.find (reader.next (TK_Symbol).text) != m_defines.end();
+				condition.hasBeenTrue = (isDefined == (name == "ifdef"));
+			}
+
+			reader.mustBeAtEnd();
+			m_isSkipping = (condition.hasBeenTrue == false);
+		}
+
+		m_conditions << condition;
+		return false;
+	}
+
+	if (name == "else" || name == "endif")
+	{
+		// Conditions can't carry on from one file to another
+		if (m_conditions.isEmpty()
+			|| m_conditions.last().location < file.start
+			|| m_conditions.last().location > file.start + file.scanner->getDataSize())
+		{
+			error ("#%1 without #if", name);
+		}
+
+		reader.mustBeAtEnd();
+		Condition& condition = m_conditions[m_conditions.size() - 1];
+
+		if (name == "else")
+		{
+			if (condition.hasElse)
+				error ("#else after #else");
+
+			condition.hasElse = true;
+			m_isSkipping = condition.wasSkipping || condition.hasBeenTrue;
+			condition.hasBeenTrue = true;
+		}
+		else
+		{
+			m_isSkipping = condition.wasSkipping;
+			m_conditions.pop (condition);
+		}
+
+		return false;
+	}
+
+	if (m_isSkipping)
+		return false;
+
+	if (name == "include")
+	{
+		*includedFile = reader.next (TK_String).text;
+		reader.mustBeAtEnd();
+		return isBuiltinFile (*includedFile) == false;
+	}
+
+	if (name == "define")
+	{
+		String symbol = reader.next (TK_Symbol).text;
+		int value = reader.isAtEnd() ? 1 : evaluateExpression (reader);
+		reader.mustBeAtEnd();
+		m_defines[symbol] = value;
+		return false;
+	}
+
+	if (name == "undef")
+	{
+		String symbol = reader.next (TK_Symbol).text;
+		reader.mustBeAtEnd();
+		m_defines.erase (symbol);
+		return false;
+	}
+
+	error ("unknown preprocessor directive \"#%1\"", name);
+	return false;
+}
+
+// =============================================================================
+//
+// Evaluates the expression of an #if or #define. Operators are those of
+// botscript, with the usual precedences. Defined symbols stand for their values
+// and other symbols for 0.
+//
+int Lexer::evaluateExpression (DirectiveReader& reader, int minPrecedence)
+{
+	int value = evaluateOperand (reader);
+
+	for (;;)
+	{
+		ETokenType op = reader.peekType();
+		int precedence;
+
+		switch (op)
+		{
+			case TK_DoubleBar:			precedence = 1; break;
+			case TK_DoubleAmperstand:	precedence = 2; break;
+			case TK_Equals:
+			case TK_NotEquals:			precedence = 3; break;
+			case TK_Lesser:
+			case TK_Greater:
+			case TK_AtLeast:
+			case TK_AtMost:				precedence = 4; break;
+			case TK_Plus:
+			case TK_Minus:				precedence = 5; break;
+			case TK_Multiply:
+			case TK_Divide:
+			case TK_Modulus:			precedence = 6; break;
+			default:					return value;
+		}
+
+		if (precedence < minPrecedence)
+			return value;
+
+		reader.next();
+		int rhs = evaluateExpression (reader, precedence + 1);
+
+		switch (op)
+		{
+			case TK_DoubleBar:			value = value || rhs; break;
+			case TK_DoubleAmperstand:	value = value && rhs; break;
+			case TK_Equals:				value = value == rhs; break;
+			case TK_NotEquals:			value = value != rhs; break;
+			case TK_Lesser:				value = value < rhs; break;
+			case TK_Greater:			value = value > rhs; break;
+			case TK_AtLeast:			value = value >= rhs; break;
+			case TK_AtMost:				value = value <= rhs; break;
+			case TK_Plus:				value += rhs; break;
+			case TK_Minus:				value -= rhs; break;
+			case TK_Multiply:			value *= rhs; break;
+
+			case TK_Divide:
+			case TK_Modulus:
+			{
+				if (rhs == 0)
+					error ("division by zero in preprocessor expression");
+
+				value = (op == TK_Divide) ? value / rhs : value % rhs;
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
+
+// =============================================================================
+//
+int Lexer::evaluateOperand (DirectiveReader& reader)
+{
+	const TokenInfo& tok = reader.next();
+
+	switch (tok.type)
+	{
+		case TK_Number:
+			return tok.number;
+
+		case TK_True:
+			return 1;
+
+		case TK_False:
+			return 0;
+
+		case TK_ExclamationMark:
+			return evaluateOperand (reader) == 0;
+
+		case TK_Minus:
+			return -evaluateOperand (reader);
+
+		case TK_ParenStart:
+		{
+			int value = evaluateExpression (reader);
+			reader.next (TK_ParenEnd);
+			return value;
+		}
+
+		case TK_Symbol:
+		{
+			String symbol = tok.text;
+
+			if (symbol == "defined")
+			{
+				bool hasParens = (reader.peekType() == TK_ParenStart);
+
+				if (hasParens)
+					reader.next();
+
+				symbol = reader.next (TK_Symbol).text;
+
+				if (hasParens)
+					reader.next (TK_ParenEnd);
+
+				return m_defines.find (symbol) != m_defines.end();
+			}
+
+			auto it = m_defines.find (symbol);
+			return (it != m_defines.end()) ? it->second : 0;
+		}
+
+		default:
+			error ("expected a value, got %1", describeToken (tok));
+			return 0;
+	}
+}
+
+// =============================================================================
+//
+// Makes sure that every condition in @file has been ended by the end of it.
+//
+void Lexer::checkConditionsClosed (SourceFile& file)
+{
+	if (m_conditions.isEmpty() == false
+		&& m_conditions.last().location >= file.start
+		&& m_conditions.last().location <= file.start + file.scanner->getDataSize())
+	{
+		ScanningFileScope scope (&file, m_conditions.last().location - file.start);
+		error ("unterminated #%1", m_conditions.last().name);
+	}
+}
+
+// =============================================================================
+//
+// Adds the token @sc is at to @batch. Unescaped strings are numbered after the
+// @numCopiedTexts strings that precede them.
+//
+void Lexer::addScannedToken (TokenBatch& batch, LexerScanner& sc, SourceLocation fileStart,
+	int& numCopiedTexts)
+{
+	StringView text = sc.getTokenText();
+	int32_t payload;
+
+	if (sc.getTokenType() == TK_Number)
+		payload = strtol (text.data(), null, 10);
+	elif (sc.isTokenTextCopied())
+	{
+		batch.copiedTexts << text;
+		payload = -(int32_t) ++numCopiedTexts;
+	}
+	else
+		payload = text.length();
+
+	batch.tokenTypes.push_back (sc.getTokenType());
+	batch.tokenLocations.push_back (fileStart + sc.getTokenOffset());
+	batch.tokenPayloads.push_back (payload);
+}
+
+// =============================================================================
+//
+// Reads up to BatchSize tokens from the innermost open file into m_batch,
+// handling preprocessor directives on the way. Returns false once all files
+// have been read through.
+//
+bool Lexer::readTokens()
+{
+	while ((int) m_batch.tokenTypes.size() < BatchSize)
+	{
+		if (m_openFiles.isEmpty())
+		{
+			m_batch.isLast = true;
+			return false;
+		}
+
+		gScanningFile = &m_openFiles[m_openFiles.size() - 1];
+		LexerScanner& sc = *gScanningFile->scanner;
+
+		if (sc.getNextToken() == false)
+		{
+			checkConditionsClosed (*gScanningFile);
+			SourceFile closedFile;
+			m_openFiles.pop (closedFile);
+			gScanningFile = null;
+			continue;
+		}
+
+		// Preprocessor commands:
+		if (sc.getTokenType() ==TK_Hash)
+		{
+			TokenBatch batch;
+			Directive directive;
+			int numCopiedTexts = 0;
+			directive.tokenIndex = 0;
+			directive.numTokens = readDirective (sc, batch, gScanningFile->start, numCopiedTexts);
+			List<TokenInfo> tokens = directiveTokens (*gScanningFile, batch, directive);
+			String fileName;
+
+			if (processDirective (*gScanningFile, tokens, &fileName) == false)
+				continue;
+
+			Module* module = loadModule (fileName);
+
+			if (module != null)
+			{
+				m_batch.modules << module;
+				m_batch.tokenTypes.push_back (TK_Module);
+				m_batch.tokenLocations.push_back (tokens.last().location);
+				m_batch.tokenPayloads.push_back (m_numModules++);
+				continue;
+			}
+
+			String path;
+			int id = m_includeResolver.resolve (fileName, &path);
+
+			for (const SourceFile& file : m_openFiles)
+			{
+				if (file.id == id)
+					error ("attempted to #include %1 recursively", fileName);
+			}
+
+			if (m_includedFiles.find (id) == m_includedFiles.end())
+				openFile (fileName);
+
+			continue;
+		}
+
+		if (m_isSkipping == false)
+			addScannedToken (m_batch, sc, gScanningFile->start, m_numCopiedTexts);
+
+		gScanningFile = null;
+	}
+
+	return true;
+}
+
+// =============================================================================
+//
+// Lexes @fileName and everything it includes. Each file is lexed just once on
+// its own, with the files it includes being queued up to be lexed by other
+// threads meanwhile. Their tokens are then spliced together in order.
+//
+void Lexer::lexInParallel (const String& fileName)
+{
+	ParallelLexing state;
+	SourceFile file = openSourceFile (fileName);
+	FileTokens* mainFile = new FileTokens;
+	mainFile->file = file;
+	state.files << mainFile;
+	state.queue << mainFile;
+	state.numBusyThreads = 0;
+	state.numListedFiles = 0;
+
+	List<std::thread*> threads;
+	int numThreads = min<int> (std::thread::hardware_concurrency(), MaxLexerThreads);
+
+	for (int i = 1; i < numThreads; ++i)
+		threads << new std::thread (&Lexer::runLexingThread, this, &state);
+
+	runLexingThread (&state);
+
+	for (std::thread* thread : threads)
+	{
+		thread->join();
+		delete thread;
+	}
+
+	listLexedFiles (state);
+	List<FileTokens*> includeStack;
+	int begin = m_tokenTypes.size();
+
+	try
+	{
+		spliceTokens (*mainFile, state, includeStack);
+	}
+	catch (...)
+	{
+		for (FileTokens* file : state.files)
+			delete file;
+
+		throw;
+	}
+
+	internSymbols (begin);
+
+	for (FileTokens* file : state.files)
+		delete file;
+
+	m_isInputDone = true;
+}
+
+// =============================================================================
+//
+// Adds the files opened since the last call to m_files, keeping them in order
+// of their locations for findFile.
+//
+void Lexer::listLexedFiles (ParallelLexing& state)
+{
+	std::vector<SourceFile*> files;
+
+	for (int i = state.numListedFiles; i < state.files.size(); ++i)
+		files.push_back (&state.files[i]->file);
+
+	std::sort (files.begin(), files.end(), [] (SourceFile* a, SourceFile* b)
+	{
+		return a->start < b->start;
+	});
+
+	for (SourceFile* file : files)
+		m_files << *file;
+
+	state.numListedFiles = state.files.size();
+}
+
+// =============================================================================
+//
+// Body of the threads lexing files in parallel. Takes files off the queue until
+// it is empty and no other thread can add to it anymore.
+//
+void Lexer::runLexingThread (ParallelLexing* state)
+{
+	CompilerContext::Scope contextScope (m_context);
+	bool wasLexerThread = gIsLexerThread;
+	gIsLexerThread = true;
+	std::unique_lock<std::mutex> lock (state->mutex);
+
+	for (;;)
+	{
+		if (state->queue.isEmpty())
+		{
+			if (state->numBusyThreads == 0)
+				break;
+
+			state->condition.wait (lock);
+			continue;
+		}
+
+		FileTokens* file = state->queue.first();
+		state->queue.removeAt (0);
+		state->numBusyThreads++;
+		lock.unlock();
+		lexFile (*file, state);
+		lock.lock();
+		state->numBusyThreads--;
+
+		if (state->queue.isEmpty() && state->numBusyThreads == 0)
+			state->condition.notify_all();
+	}
+
+	gIsLexerThread = wasLexerThread;
+}
+
+// =============================================================================
+//
+// Lexes a single file for lexInParallel. Files included by it outside of
+// conditions are opened as they are found and queued up, unless they already
+// have been. If an error is raised, the lexing stops there and the error is
+// kept to be thrown once the tokens before it are spliced in. Files that have
+// been lexed before are loaded from the token cache instead.
+//
+void Lexer::lexFile (FileTokens& file, ParallelLexing* state)
+{
+	if (isCaching() && loadCachedTokens (file, state))
+		return;
+
+	int numCopiedTexts = 0;
+	int depth = 0;
+	gScanningFile = &file.file;
+
+	try
+	{
+		LexerScanner& sc = *file.file.scanner;
+
+		while (sc.getNextToken())
+		{
+			if (sc.getTokenType() !=TK_Hash)
+			{
+				addScannedToken (file.tokens, sc, file.file.start, numCopiedTexts);
+				continue;
+			}
+
+			Directive directive;
+			directive.tokenIndex = file.tokens.tokenTypes.size();
+			directive.numTokens = readDirective (sc, file.tokens, file.file.start, numCopiedTexts);
+			file.directives << directive;
+			file.includedFiles << null;
+			file.includedFiles[file.includedFiles.size() - 1] =
+				queueIncludedFile (file, directive, depth, state);
+		}
+	}
+	catch (std::exception& e)
+	{
+		file.tokens.error = e.what();
+	}
+
+	gScanningFile = null;
+
+	if (isCaching() && file.tokens.error.isEmpty())
+		storeCachedTokens (file);
+}
+
+// =============================================================================
+//
+// Opens @fileName and queues it up to be lexed, unless it already has been.
+// Returns the tokens it will be lexed into.
+//
+Lexer::FileTokens* Lexer::queueFile (const String& fileName, ParallelLexing* state)
+{
+	String path;
+	int id = m_includeResolver.resolve (fileName, &path);
+	std::lock_guard<std::mutex> lock (state->mutex);
+	FileTokens* file = state->findFile (id);
+
+	if (file != null)
+		return file;
+
+	file = new FileTokens;
+
+	try
+	{
+		file->file = openSourceFile (fileName);
+	}
+	catch (...)
+	{
+		delete file;
+		throw;
+	}
+
+	state->files << file;
+	state->queue << file;
+	state->condition.notify_one();
+	return file;
+}
 
 // =============================================================================
 //
-Lexer::Lexer()
+// Looks at a directive of @file as it is lexed in parallel. #includes outside of
+// conditions are always carried out, so their files are queued up right away
+// and returned. @depth counts the conditions the directive is in. Files that
+// have a module are left alone, as it will likely be included instead.
+//
+Lexer::FileTokens* Lexer::queueIncludedFile (FileTokens& file, const Directive& directive,
+	int& depth, ParallelLexing* state)
 {
-	ASSERT_EQ (gMainLexer, null);
-	gMainLexer = this;
+	List<TokenInfo> tokens = directiveTokens (file.file, file.tokens, directive);
+
+	if (tokens[0].text == "if" || tokens[0].text == "ifdef" || tokens[0].text == "ifndef")
+		depth++;
+	elif (tokens[0].text == "endif" && depth > 0)
+		depth--;
+	elif (tokens[0].text == "include" && depth == 0 && tokens.size() == 2
+		&& tokens[1].type == TK_String && isBuiltinFile (tokens[1].text) == false
+		&& hasModule (tokens[1].text) == false)
+	{
+		return queueFile (tokens[1].text, state);
+	}
+
+	return null;
 }
 
 // =============================================================================
 //
-Lexer::~Lexer()
+// Fills in the tokens of @file from the token cache, if they are there. The
+// files it includes are queued up as if they had just been lexed. If one of
+// them cannot be opened, the file is lexed after all so that the error gets
+// reported at the right place.
+//
+bool Lexer::loadCachedTokens (FileTokens& file, ParallelLexing* state)
 {
-	gMainLexer = null;
+	const LexerScanner& sc = *file.file.scanner;
+	TokenCacheEntry entry;
+
+	if (TokenCache::load (sc.getData(), sc.getDataSize(), file.file.start, entry) == false)
+		return false;
+
+	file.tokens.tokenTypes.swap (entry.tokenTypes);
+	file.tokens.tokenLocations.swap (entry.tokenLocations);
+	file.tokens.tokenPayloads.swap (entry.tokenPayloads);
+	file.tokens.copiedTexts = entry.copiedTexts;
+	file.directives = entry.directives;
+	int depth = 0;
+
+	try
+	{
+		for (const Directive& directive : file.directives)
+			file.includedFiles << queueIncludedFile (file, directive, depth, state);
+	}
+	catch (std::exception&)
+	{
+		file.tokens = TokenBatch();
+		file.tokens.isLast = false;
+		file.directives.clear();
+		file.includedFiles.clear();
+		return false;
+	}
+
+	return true;
 }
 
 // =============================================================================
 //
-void Lexer::processFile (String fileName)
+void Lexer::storeCachedTokens (const FileTokens& file)
 {
-	gFileNameStack << fileName;
-	FILE* fp = fopen (fileName, "r");
-
-	if (fp == null)
-		error ("couldn't open %1 for reading: %2", fileName, strerror (errno));
+	const LexerScanner& sc = *file.file.scanner;
+	TokenCacheEntry entry;
+	entry.tokenTypes = file.tokens.tokenTypes;
+	entry.tokenLocations = file.tokens.tokenLocations;
+	entry.tokenPayloads = file.tokens.tokenPayloads;
+	entry.copiedTexts = file.tokens.copiedTexts;
+	entry.directives = file.directives;
+	TokenCache::store (sc.getData(), sc.getDataSize(), file.file.start, entry);
+}
 
-	LexerScanner sc (fp);
-	checkFileHeader (sc);
+// =============================================================================
+//
+// Adds the tokens of @file to the token arrays, carrying out its preprocessor
+// directives on the way. The tokens of the files it includes go in their
+// places, except for files that have already been included. Files that are
+// included within conditions are only lexed here, once they turn out to be.
+//
+void Lexer::spliceTokens (FileTokens& file, ParallelLexing& state,
+	List<FileTokens*>& includeStack)
+{
+	const TokenBatch& tokens = file.tokens;
+	int begin = 0;
+	includeStack << &file;
+	m_includedFiles.insert (file.file.id);
 
-	while (sc.getNextToken())
+	for (int i = 0; i <= file.directives.size(); ++i)
 	{
-		// Preprocessor commands:
-		if (sc.getTokenType() ==TK_Hash)
+		int end = (i < file.directives.size()) ? file.directives[i].tokenIndex : tokens.tokenTypes.size();
+
+		for (int j = begin; j < end && m_isSkipping == false; ++j)
 		{
-			mustGetFromScanner (sc,TK_Symbol);
+			int32_t payload = tokens.tokenPayloads[j];
 
-			if (sc.getTokenText() == "include")
+			// Renumber the unescaped strings to follow the ones before them
+			if (tokens.tokenTypes[j] == TK_String && payload < 0)
 			{
-				mustGetFromScanner (sc,TK_String);
-				String fileName = sc.getTokenText();
+				m_copiedTexts << tokens.copiedTexts[-1 - payload];
+				payload = -(int32_t) (m_firstCopiedText + m_copiedTexts.size());
+			}
 
-				if (gFileNameStack.contains (fileName))
-					error ("attempted to #include %1 recursively", sc.getTokenText());
+			m_tokenTypes.push_back (tokens.tokenTypes[j]);
+			m_tokenLocations.push_back (tokens.tokenLocations[j]);
+			m_tokenPayloads.push_back (payload);
+		}
+
+		if (i == file.directives.size())
+			break;
+
+		const Directive& directive = file.directives[i];
+		List<TokenInfo> directiveTokens = Lexer::directiveTokens (file.file, tokens, directive);
+		String fileName;
+		begin = directive.tokenIndex + directive.numTokens;
+
+		if (processDirective (file.file, directiveTokens, &fileName) == false)
+			continue;
+
+		Module* module = loadModule (fileName);
+
+		if (module != null)
+		{
+			m_modules << module;
+			m_tokenTypes.push_back (TK_Module);
+			m_tokenLocations.push_back (directiveTokens.last().location);
+			m_tokenPayloads.push_back (m_numModules++);
+			continue;
+		}
 
-				processFile (fileName);
+		FileTokens* includedFile = file.includedFiles[i];
+
+		{
+			// Errors are reported at the name of the file
+			ScanningFileScope scope (&file.file, directiveTokens.last().location - file.file.start);
+
+			if (includedFile == null)
+			{
+				includedFile = queueFile (fileName, &state);
+				runLexingThread (&state);
+				listLexedFiles (state);
 			}
-			else
-				error ("unknown preprocessor directive \"#%1\"", sc.getTokenText());
+
+			if (includeStack.contains (includedFile))
+				error ("attempted to #include %1 recursively", fileName);
+		}
+
+		if (m_includedFiles.find (includedFile->file.id) == m_includedFiles.end())
+			spliceTokens (*includedFile, state, includeStack);
+	}
+
+	if (tokens.error.isEmpty() == false)
+		throw std::runtime_error (tokens.error.stdString());
+
+	checkConditionsClosed (file.file);
+	FileTokens* splicedFile;
+	includeStack.pop (splicedFile);
+}
+
+// =============================================================================
+//
+// Body of the lexer thread. Errors are passed on to the parser along with
+// the tokens preceding them, so that they come up in the same order as they
+// would without a thread.
+//
+void Lexer::runLexerThread()
+{
+	CompilerContext::Scope contextScope (m_context);
+	gIsLexerThread = true;
+
+	try
+	{
+		while (readTokens() && m_isStopping == false)
+			pushBatch();
+	}
+	catch (std::exception& e)
+	{
+		m_batch.error = e.what();
+		m_batch.isLast = true;
+	}
+
+	pushBatch();
+}
+
+// =============================================================================
+//
+// Passes m_batch on to the parser, waiting for room in the pipeline if needed.
+//
+void Lexer::pushBatch()
+{
+	unsigned tail = m_pipelineTail.load (std::memory_order_relaxed);
+
+	while (tail - m_pipelineHead.load (std::memory_order_acquire) == PipelineSize)
+	{
+		if (m_isStopping)
+			return;
+
+		std::this_thread::yield();
+	}
+
+	// The slot has been emptied by fetchTokens, so m_batch is clear after this
+	std::swap (m_batch, m_pipeline[tail % PipelineSize]);
+	m_pipelineTail.store (tail + 1, std::memory_order_release);
+}
+
+// =============================================================================
+//
+// Moves the contents of @batch to the token arrays and clears it. The error
+// the lexer ran into, if any, is thrown once the tokens before it are in.
+//
+void Lexer::addTokens (TokenBatch& batch)
+{
+	if (isStreaming())
+		discardOldTokens();
+
+	int begin = m_tokenTypes.size();
+	m_files << batch.files;
+	m_modules << batch.modules;
+	m_copiedTexts << batch.copiedTexts;
+	m_tokenTypes.insert (m_tokenTypes.end(), batch.tokenTypes.begin(), batch.tokenTypes.end());
+	m_tokenLocations.insert (m_tokenLocations.end(), batch.tokenLocations.begin(), batch.tokenLocations.end());
+	m_tokenPayloads.insert (m_tokenPayloads.end(), batch.tokenPayloads.begin(), batch.tokenPayloads.end());
+	m_isInputDone = batch.isLast;
+	internSymbols (begin);
+
+	String error = batch.error;
+	batch.tokenTypes.clear();
+	batch.tokenLocations.clear();
+	batch.tokenPayloads.clear();
+	batch.copiedTexts.clear();
+	batch.files.clear();
+	batch.modules.clear();
+	batch.error = "";
+	batch.isLast = false;
+
+	if (error.isEmpty() == false)
+		throw std::runtime_error (error.stdString());
+}
+
+// =============================================================================
+//
+// Adds more tokens to the token arrays, either by reading them or taking them
+// from the lexer thread. Returns false if there are no more tokens.
+//
+bool Lexer::fetchTokens()
+{
+	while (m_isInputDone == false)
+	{
+		int oldEnd = tokenEnd();
+
+		if (isPipelined())
+		{
+			unsigned head = m_pipelineHead.load (std::memory_order_relaxed);
+
+			while (m_pipelineTail.load (std::memory_order_acquire) == head)
+				std::this_thread::yield();
+
+			// Take the batch out and leave the empty one in its place
+			std::swap (m_receivedBatch, m_pipeline[head % PipelineSize]);
+			m_pipelineHead.store (head + 1, std::memory_order_release);
+			addTokens (m_receivedBatch);
 		}
 		else
 		{
-			TokenInfo tok;
-			tok.file = fileName;
-			tok.line = sc.getLine();
-			tok.column = sc.getColumn();
-			tok.type = sc.getTokenType();
-			tok.text = sc.getTokenText();
-
-			// devf ("Token #%1: %2:%3:%4: %5 (%6)\n", mTokens.size(),
-			// 	tok.file, tok.line, tok.column, DescribeToken (&tok),
-			// 	GetTokenTypeString (tok.type));
-
-			m_tokens << tok;
+			readTokens();
+			addTokens (m_batch);
+		}
+
+		if (tokenEnd() > oldEnd)
+			return true;
+	}
+
+	return false;
+}
+
+// =============================================================================
+//
+// Makes sure that the token at @pos has been read, if there is one.
+//
+bool Lexer::fetchTokensUpTo (int pos)
+{
+	while (pos >= tokenEnd())
+	{
+		if (fetchTokens() == false)
+			return false;
+	}
+
+	return true;
+}
+
+// =============================================================================
+//
+// Drops tokens that have fallen out of the window when streaming: the ones
+// more than TokenLookbehind tokens behind the current position or the oldest
+// checkpoint, whichever is earlier. This is only done once the window is full
+// and at least half of it can go at once, so the cost is amortized.
+//
+void Lexer::discardOldTokens()
+{
+	if ((int) m_tokenTypes.size() < TokenWindowSize)
+		return;
+
+	int keepFrom = m_tokenPosition - TokenLookbehind;
+
+	if (m_checkpoints.isEmpty() == false)
+		keepFrom = min (keepFrom, m_checkpoints.first());
+
+	int count = keepFrom - m_firstToken;
+
+	if (count < (int) m_tokenTypes.size() / 2)
+		return;
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (m_tokenTypes[i] == TK_String && m_tokenPayloads[i] < 0)
+		{
+			m_copiedTexts.removeAt (0);
+			m_firstCopiedText++;
 		}
 	}
 
-	m_tokenPosition = m_tokens.begin() - 1;
-	gFileNameStack.removeOne (fileName);
+	m_tokenTypes.erase (m_tokenTypes.begin(), m_tokenTypes.begin() + count);
+	m_tokenLocations.erase (m_tokenLocations.begin(), m_tokenLocations.begin() + count);
+	m_tokenPayloads.erase (m_tokenPayloads.begin(), m_tokenPayloads.begin() + count);
+	m_firstToken += count;
 }
 
 // ============================================================================
@@ -147,20 +1366,25 @@ void Lexer::checkFileHeader (LexerScanner& sc)
 //
 bool Lexer::next (ETokenType req)
 {
-	Iterator pos = m_tokenPosition;
+	if (fetchTokensUpTo (m_tokenPosition + 1) == false)
+		return false;
 
-	if (m_tokens.isEmpty())
+	if (req !=TK_Any && (ETokenType) m_tokenTypes[m_tokenPosition + 1 - m_firstToken] != req)
 		return false;
 
 	m_tokenPosition++;
+	return true;
+}
 
-	if (isAtEnd() || (req !=TK_Any && tokenType() != req))
-	{
-		m_tokenPosition = pos;
-		return false;
-	}
+// =============================================================================
+//
+void Lexer::skip (int a)
+{
+	m_tokenPosition += a;
+	ASSERT_LT_EQ (m_firstToken - 1, m_tokenPosition)
 
-	return true;
+	if (a > 0)
+		fetchTokensUpTo (m_tokenPosition);
 }
 
 // =============================================================================
@@ -188,12 +1412,10 @@ void Lexer::mustGetFromScanner (LexerScanner& sc, ETokenType tt)
 		TokenInfo tok;
 		tok.type = sc.getTokenType();
 		tok.text = sc.getTokenText();
+		tok.location = 0;
+		tok.number = 0;
 
-		error ("at %1:%2: expected %3, got %4",
-			gFileNameStack.last(),
-			sc.getLine(),
-			describeTokenType (tt),
-			describeToken (&tok));
+		error ("expected %1, got %2", describeTokenType (tt), describeToken (tok));
 	}
 }
 
@@ -234,7 +1456,7 @@ int Lexer::getOneSymbol (const StringList& syms)
 	{
 		for (int i = 0; i < syms.size(); ++i)
 		{
-			if (syms[i] == token()->text)
+			if (token().text == syms[i])
 				return i;
 		}
 	}
@@ -254,17 +1476,18 @@ void Lexer::tokenMustBe (ETokenType tok)
 
 // =============================================================================
 //
-String Lexer::describeTokenPrivate (ETokenType tokType, Lexer::TokenInfo* tok)
+String Lexer::describeTokenPrivate (ETokenType tokType, const Lexer::TokenInfo* tok)
 {
 	if (tokType <gLastNamedToken)
 		return "\"" + LexerScanner::getTokenString (tokType) + "\"";
 
 	switch (tokType)
 	{
-		case TK_Symbol:	return tok ? tok->text : "a symbol";
-		case TK_Number:	return tok ? tok->text : "a number";
-		case TK_String:	return tok ? ("\"" + tok->text + "\"") : "a string";
-		case TK_Any:	return tok ? tok->text : "any token";
+		case TK_Symbol:	return tok ? tok->text.toString() : "a symbol";
+		case TK_Number:	return tok ? tok->text.toString() : "a number";
+		case TK_String:	return tok ? ("\"" + tok->text.toString() + "\"") : "a string";
+		case TK_Module:	return tok ? tok->text.toString() : "a precompiled module";
+		case TK_Any:	return tok ? tok->text.toString() : "any token";
 		default: break;
 	}
 
@@ -275,11 +1498,11 @@ String Lexer::describeTokenPrivate (ETokenType tokType, Lexer::TokenInfo* tok)
 //
 bool Lexer::peekNext (Lexer::TokenInfo* tk)
 {
-	Iterator pos = m_tokenPosition;
+	int pos = m_tokenPosition;
 	bool r = next();
 
 	if (r && tk != null)
-		*tk = *m_tokenPosition;
+		*tk = token();
 
 	m_tokenPosition = pos;
 	return r;
@@ -289,7 +1512,7 @@ bool Lexer::peekNext (Lexer::TokenInfo* tk)
 //
 bool Lexer::peekNextType (ETokenType req)
 {
-	Iterator pos = m_tokenPosition;
+	int pos = m_tokenPosition;
 	bool result = false;
 
 	if (next() && tokenType() == req)
@@ -301,37 +1524,213 @@ bool Lexer::peekNextType (ETokenType req)
 
 // =============================================================================
 //
-Lexer* Lexer::getCurrentLexer()
+String Lexer::peekNextString (int a)
 {
-	return gMainLexer;
+	if (fetchTokensUpTo (m_tokenPosition + a) == false)
+		return "";
+
+	return tokenAt (m_tokenPosition + a).text;
 }
 
 // =============================================================================
 //
-String Lexer::peekNextString (int a)
+String Lexer::describeCurrentPosition()
 {
-	if (m_tokenPosition + a >= m_tokens.end())
-		return "";
-
-	Iterator oldpos = m_tokenPosition;
-	m_tokenPosition += a;
-	String result = token()->text;
-	m_tokenPosition = oldpos;
-	return result;
+	return describeLocation (token().location);
 }
 
 // =============================================================================
 //
-String Lexer::describeCurrentPosition()
+String Lexer::describeLocation (SourceLocation loc)
 {
-	return token()->file + ":" + token()->line;
+	String file;
+	int line, column;
+	decodeLocation (loc, &file, &line, &column);
+	return file + ":" + line;
 }
 
 // =============================================================================
 //
 String Lexer::describeTokenPosition()
 {
-	return format ("%1 / %2", m_tokenPosition - m_tokens.begin(), m_tokens.size());
+	return format ("%1 / %2", m_tokenPosition, tokenEnd());
+}
+
+// =============================================================================
+//
+// Puts the token at index @i together from the token arrays.
+//
+Lexer::TokenInfo Lexer::tokenAt (int i) const
+{
+	ASSERT_RANGE (i, m_firstToken, tokenEnd() - 1)
+	ETokenType type = (ETokenType) m_tokenTypes[i - m_firstToken];
+	SourceLocation location = m_tokenLocations[i - m_firstToken];
+	int32_t payload = m_tokenPayloads[i - m_firstToken];
+	const SourceFile& file = m_files[findFile (location)];
+
+	if (type == TK_Symbol)
+	{
+		TokenInfo tok = makeToken (type, location, m_context->names().info (payload).name.length(), file,
+			m_copiedTexts, m_firstCopiedText);
+		tok.name = payload;
+		return tok;
+	}
+
+	if (type == TK_Module)
+	{
+		TokenInfo tok;
+		tok.type = type;
+		tok.text = StringView (m_modules[payload]->path);
+		tok.location = location;
+		tok.number = payload;
+		tok.name = -1;
+		return tok;
+	}
+
+	return makeToken (type, location, payload, file, m_copiedTexts, m_firstCopiedText);
+}
+
+// =============================================================================
+//
+// Enters the names of the symbols from the @begin'th token in the arrays on
+// into the name table, replacing their payloads with the ids of the names.
+//
+void Lexer::internSymbols (int begin)
+{
+	const SourceFile* file = null;
+
+	for (int i = begin; i < (int) m_tokenTypes.size(); ++i)
+	{
+		if (m_tokenTypes[i] != TK_Symbol)
+			continue;
+
+		SourceLocation location = m_tokenLocations[i];
+
+		// Symbols mostly come from the same file as the one before them
+		if (file == null || location < file->start
+			|| location > file->start + file->scanner->getDataSize())
+		{
+			file = &m_files[findFile (location)];
+		}
+
+		const char* text = file->scanner->getData() + (location - file->start);
+		m_tokenPayloads[i] = m_context->names().intern (text, m_tokenPayloads[i]);
+	}
+}
+
+// =============================================================================
+//
+// Puts a token together from its type, location and payload. The token is in
+// @file. Unescaped strings are looked up from @copiedTexts, which starts from
+// the string numbered @firstCopiedText.
+//
+Lexer::TokenInfo Lexer::makeToken (ETokenType type, SourceLocation location, int32_t payload,
+	const SourceFile& file, const List<String>& copiedTexts, int firstCopiedText)
+{
+	TokenInfo tok;
+	tok.type = type;
+	tok.location = location;
+	tok.number = 0;
+	tok.name = -1;
+	const char* start = file.scanner->getData() + (location - file.start);
+
+	switch (tok.type)
+	{
+		case TK_Number:
+			tok.number = payload;
+			tok.text = StringView (start, strspn (start, "0123456789"));
+			break;
+
+		case TK_String:
+			if (payload >= 0)
+				tok.text = StringView (start + 1, payload);
+			else
+				tok.text = StringView (copiedTexts[-1 - payload - firstCopiedText]);
+			break;
+
+		default:
+			tok.text = StringView (start, payload);
+			break;
+	}
+
+	return tok;
+}
+
+// =============================================================================
+//
+// Puts together the tokens of @directive, which is in @file and has been read
+// into @batch.
+//
+List<Lexer::TokenInfo> Lexer::directiveTokens (const SourceFile& file, const TokenBatch& batch,
+	const Directive& directive)
+{
+	List<TokenInfo> tokens;
+
+	for (int i = directive.tokenIndex; i < directive.tokenIndex + directive.numTokens; ++i)
+	{
+		tokens << makeToken ((ETokenType) batch.tokenTypes[i], batch.tokenLocations[i],
+			batch.tokenPayloads[i], file, batch.copiedTexts, 0);
+	}
+
+	return tokens;
+}
+
+// =============================================================================
+//
+// Returns the index of the file @loc is in.
+//
+int Lexer::findFile (SourceLocation loc) const
+{
+	int low = 0;
+	int high = m_files.size() - 1;
+
+	while (low < high)
+	{
+		int mid = (low + high + 1) / 2;
+
+		if (m_files[mid].start <= loc)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	return low;
+}
+
+// =============================================================================
+//
+// Finds out the file, line and column of @loc.
+//
+void Lexer::decodeLocation (SourceLocation loc, String* file, int* line, int* column)
+{
+	SourceFile& sourceFile = m_files[findFile (loc)];
+	*file = sourceFile.name;
+	decodeOffset (sourceFile, loc - sourceFile.start, line, column);
+}
+
+// =============================================================================
+//
+// Finds out the line and column of @offset in @file. The line offsets of the
+// file are looked up the first time this is done for it.
+//
+void Lexer::decodeOffset (SourceFile& file, int offset, int* line, int* column)
+{
+	std::vector<int>& lineOffsets = file.lineOffsets;
+
+	if (lineOffsets.empty())
+	{
+		const char* data = file.scanner->getData();
+		const char* end = data + file.scanner->getDataSize();
+		lineOffsets.push_back (0);
+
+		for (const char* p = data; (p = (const char*) memchr (p, '\n', end - p)) != null; ++p)
+			lineOffsets.push_back (p + 1 - data);
+	}
+
+	int lineIndex = std::upper_bound (lineOffsets.begin(), lineOffsets.end(), offset)
+		- lineOffsets.begin() - 1;
+	*line = lineIndex + 1;
+	*column = offset - lineOffsets[lineIndex] + 1;
 }
 
 // =============================================================================
@@ -339,6 +1738,68 @@ String Lexer::describeTokenPosition()
 void Lexer::mustGetSymbol (const String& a)
 {
 	mustGetNext (TK_Any);
-	if (token()->text != a)
-		error ("expected \"%1\", got \"%2\"", a, token()->text);
+	if (token().text != a)
+		error ("expected \"%1\", got \"%2\"", a, token().text);
+}
+
+// =============================================================================
+//
+// Finds the position an error should be reported at: the token being read if
+// the lexer is in the middle of reading one, otherwise the current token. The
+// lexer thread of a pipelined lexer only knows of the former and the parser
+// only of the latter.
+//
+bool Lexer::getErrorPosition (String* file, int* line, int* column)
+{
+	if (gScanningFile != null)
+	{
+		int offset = (gScanningOffset != -1) ? gScanningOffset : gScanningFile->scanner->getTokenOffset();
+		*file = gScanningFile->name;
+		decodeOffset (*gScanningFile, offset, line, column);
+		return true;
+	}
+
+	if (gIsLexerThread)
+		return false;
+
+	if (hasValidToken())
+	{
+		decodeLocation (m_tokenLocations[m_tokenPosition - m_firstToken], file, line, column);
+		return true;
+	}
+
+	return false;
+}
+
+// =============================================================================
+//
+Lexer::Checkpoint::Checkpoint (Lexer* lexer) :
+	m_lexer (lexer),
+	m_position (lexer->position())
+{
+	m_lexer->m_checkpoints << m_position;
+}
+
+// =============================================================================
+//
+// Checkpoints are destroyed in the reverse order they were made in. This may
+// happen while an error is thrown, so a checkpoint that is out of order can't
+// be reported with another one; it would be a bug in botc anyway.
+//
+Lexer::Checkpoint::~Checkpoint()
+{
+	int position = -1;
+
+	if (m_lexer->m_checkpoints.pop (position) == false || position != m_position)
+	{
+		fprintf (stderr, "checkpoint at %d destroyed out of order\n", m_position);
+		abort();
+	}
+}
+
+// =============================================================================
+//
+void Lexer::Checkpoint::rewind()
+{
+	m_lexer->setPosition (m_position);
 }
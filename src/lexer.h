@@ -29,29 +29,72 @@
 #ifndef BOTC_LEXER_H
 #define BOTC_LEXER_H
 
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
 #include "main.h"
+#include "includeResolver.h"
 #include "lexerScanner.h"
+#include "nameTable.h"
+#include "tokenCache.h"
+
+class CompilerContext;
+class Module;
 
 class Lexer
 {
+	PROPERTY (public, bool, isStreaming, setStreaming, STOCK_WRITE)
+	PROPERTY (public, bool, isPipelined, setPipelined, STOCK_WRITE)
+	PROPERTY (public, bool, isCaching, setCaching, STOCK_WRITE)
+	PROPERTY (public, bool, hasBuiltinDefinitions, setHasBuiltinDefinitions, STOCK_WRITE)
+
 public:
+	// A token as seen by the parser. These are not stored as such but are put
+	// together from the token arrays whenever they are asked for.
 	struct TokenInfo
 	{
-		ETokenType	type;
-		String		text;
-		String		file;
-		int			line;
-		int			column;
+		ETokenType		type;
+		StringView		text;
+		SourceLocation	location;
+		int				number; // value of a TK_Number
+		int				name; // id of a TK_Symbol in the name table
 	};
 
-	using TokenList	= List<TokenInfo>;
-	using Iterator	= TokenList::Iterator;
+	struct SourceFile
+	{
+		String				name;
+		LexerScanner*		scanner;
+		SourceLocation		start;
+		int					id; // see IncludeResolver
+
+		// Offsets of the first character of each line. Only looked up once a
+		// location within the file needs to be described.
+		std::vector<int>	lineOffsets;
+	};
+
+	// Keeps the tokens from the current position onwards around until it is
+	// destroyed, so that the lexer can be rewound back to it even when it is
+	// streaming.
+	class Checkpoint
+	{
+	public:
+		Checkpoint (Lexer* lexer);
+		~Checkpoint();
+		void rewind();
+
+	private:
+		Lexer*	m_lexer;
+		int		m_position;
+	};
 
 public:
-	Lexer();
+	Lexer (CompilerContext* context);
 	~Lexer();
 
 	void	processFile (String fileName);
+	void	define (const String& name, int value);
 	bool	next (ETokenType req = TK_Any);
 	void	mustGetNext (ETokenType tok);
 	void	mustGetAnyOf (const List<ETokenType>& toks);
@@ -62,44 +105,71 @@ public:
 	bool	peekNextType (ETokenType req);
 	String	peekNextString (int a = 1);
 	String	describeCurrentPosition();
+	String	describeLocation (SourceLocation loc);
 	String	describeTokenPosition();
+	void	decodeLocation (SourceLocation loc, String* file, int* line, int* column);
+	bool	getErrorPosition (String* file, int* line, int* column);
+	void	skip (int a = 1);
+
+	inline IncludeResolver& includeResolver()
+	{
+		return m_includeResolver;
+	}
+
+	inline const List<SourceFile>& files() const
+	{
+		return m_files;
+	}
+
+	// The #defines given before the script, and those in effect after it.
+	inline const std::map<String, int>& initialDefines() const
+	{
+		return m_initialDefines;
+	}
+
+	inline const std::map<String, int>& defines() const
+	{
+		return m_defines;
+	}
 
-	static Lexer* getCurrentLexer();
+	// The precompiled modules included so far. The number of a TK_Module is
+	// the index of its module in this list.
+	inline const List<Module*>& modules() const
+	{
+		return m_modules;
+	}
 
 	inline bool hasValidToken() const
 	{
-		return (m_tokenPosition < m_tokens.end() && m_tokenPosition >= m_tokens.begin());
+		return (m_tokenPosition < tokenEnd() && m_tokenPosition >= m_firstToken);
 	}
 
-	inline TokenInfo* token() const
+	inline TokenInfo token() const
 	{
 		ASSERT (hasValidToken());
-		return &(*m_tokenPosition);
+		return tokenAt (m_tokenPosition);
 	}
 
 	inline bool isAtEnd() const
 	{
-		return m_tokenPosition == m_tokens.end();
+		return m_tokenPosition == tokenEnd() && m_isInputDone;
 	}
 
 	inline ETokenType tokenType() const
 	{
-		return token()->type;
-	}
-
-	inline void skip (int a = 1)
-	{
-		m_tokenPosition += a;
+		ASSERT (hasValidToken());
+		return (ETokenType) m_tokenTypes[m_tokenPosition - m_firstToken];
 	}
 
 	inline int position()
 	{
-		return m_tokenPosition - m_tokens.begin();
+		return m_tokenPosition;
 	}
 
 	inline void setPosition (int pos)
 	{
-		m_tokenPosition = m_tokens.begin() + pos;
+		ASSERT_RANGE (pos, m_firstToken - 1, tokenEnd())
+		m_tokenPosition = pos;
 	}
 
 	// If @tok is given, describes the token. If not, describes @tok_type.
@@ -108,20 +178,185 @@ public:
 		return describeTokenPrivate (toktype, null);
 	}
 
-	static inline String describeToken (TokenInfo* tok)
+	static inline String describeToken (const TokenInfo& tok)
 	{
-		return describeTokenPrivate (tok->type, tok);
+		return describeTokenPrivate (tok.type, &tok);
 	}
 
 private:
-	TokenList		m_tokens;
-	Iterator		m_tokenPosition;
+	enum
+	{
+		// How many tokens are kept around when streaming, and how many of them
+		// may be behind the current position
+		TokenWindowSize = 1024,
+		TokenLookbehind = 16,
+
+		// How many tokens are read at a time, and how many such batches may
+		// be waiting for the parser when the lexer runs in a thread
+		BatchSize = 256,
+		PipelineSize = 16,
+
+		// How many threads may lex files in parallel
+		MaxLexerThreads = 8,
+	};
+
+	// Tokens that have been read from the source but not yet added to the
+	// token arrays, along with the files and unescaped strings they need.
+	struct TokenBatch
+	{
+		std::vector<uint8_t>		tokenTypes;
+		std::vector<SourceLocation>	tokenLocations;
+		std::vector<int32_t>		tokenPayloads;
+		List<String>				copiedTexts;
+		List<SourceFile>			files;
+		List<Module*>				modules;
+		String						error;
+		bool						isLast;
+	};
+
+	using Directive = TokenCacheEntry::Directive;
+
+	// An #if, #ifdef or #ifndef whose #endif has not been reached yet.
+	struct Condition
+	{
+		String						name;
+		SourceLocation				location;
+		bool						wasSkipping; // whether code was left out before it
+		bool						hasBeenTrue;
+		bool						hasElse;
+	};
+
+	// The tokens of a single file when files are lexed in parallel. These
+	// include the tokens of its preprocessor directives, which are carried out
+	// once the tokens are spliced together. Each directive that is an #include
+	// outside of any conditions has the file it includes in @includedFiles,
+	// as those files are lexed right away.
+	struct FileTokens
+	{
+		SourceFile					file;
+		TokenBatch					tokens;
+		List<Directive>				directives;
+		List<FileTokens*>			includedFiles;
+	};
+
+	struct ParallelLexing;
+	class DirectiveReader;
+
+	// The compilation the lexer is part of, whose name table holds the names
+	// of its symbols
+	CompilerContext*			m_context;
+
+	// The tokens are stored as parallel arrays, starting from the token
+	// numbered m_firstToken. The payload of a TK_Number is its value and that
+	// of a TK_Symbol is the id of its name. The payload of a TK_String is the
+	// length of its text, or if negative, -1 - the number of its unescaped
+	// text in m_copiedTexts. A TK_Module is located at the name of the file
+	// in its #include and its payload is the number of its module. For other
+	// tokens it is the length of the text.
+	//
+	// Until they are added to the token arrays, TK_Symbols have the length of
+	// their text as their payload, too.
+	std::vector<uint8_t>		m_tokenTypes;
+	std::vector<SourceLocation>	m_tokenLocations;
+	std::vector<int32_t>		m_tokenPayloads;
+	List<String>				m_copiedTexts;
+	int							m_firstToken;
+	int							m_firstCopiedText;
+	int							m_tokenPosition;
+	List<int>					m_checkpoints;
+
+	// Token text refers to the scanners' data, so they are kept alive for
+	// as long as the lexer is.
+	List<SourceFile>			m_files;
+	bool						m_isInputDone;
+
+	// Files are only ever included once. The ones that have been are listed
+	// here by their ids.
+	IncludeResolver				m_includeResolver;
+	std::set<int>				m_includedFiles;
+
+	// State of the preprocessor. Tokens are left out while m_isSkipping is
+	// set, i.e. within a condition that is false.
+	std::map<String, int>		m_defines;
+	std::map<String, int>		m_initialDefines;
+	List<Condition>				m_conditions;
+	bool						m_isSkipping;
+
+	// Modules that are #included instead of scripts. Like files, they come
+	// in with the batches when streaming, and are counted by m_numModules on
+	// the reading side.
+	List<Module*>				m_modules;
+	int							m_numModules;
+
+	// The reading side. When pipelined, these are only touched by the lexer
+	// thread once it has been started. Files currently being read are in
+	// m_openFiles, innermost #include last.
+	List<SourceFile>			m_openFiles;
+	SourceLocation				m_nextFileStart;
+	int							m_numCopiedTexts;
+	TokenBatch					m_batch;
+	TokenBatch					m_receivedBatch;
+
+	// Batches passed from the lexer thread to the parser. The lexer thread
+	// only advances m_pipelineTail and the parser only m_pipelineHead.
+	TokenBatch					m_pipeline[PipelineSize];
+	std::atomic<unsigned>		m_pipelineHead;
+	std::atomic<unsigned>		m_pipelineTail;
+	std::atomic<bool>			m_isStopping;
+	std::thread					m_lexerThread;
+
+	inline int tokenEnd() const
+	{
+		return m_firstToken + m_tokenTypes.size();
+	}
+
+	TokenInfo	tokenAt (int i) const;
+	int			findFile (SourceLocation loc) const;
+	SourceFile	openSourceFile (const String& fileName);
+	void		openFile (const String& fileName);
+	int			readDirective (LexerScanner& sc, TokenBatch& batch, SourceLocation fileStart,
+					int& numCopiedTexts);
+	bool		isBuiltinFile (const String& fileName);
+	bool		hasModule (const String& fileName);
+	Module*		loadModule (const String& fileName);
+	bool		processDirective (SourceFile& file, const List<TokenInfo>& tokens,
+					String* includedFile);
+	int			evaluateExpression (DirectiveReader& reader, int minPrecedence = 0);
+	int			evaluateOperand (DirectiveReader& reader);
+	void		checkConditionsClosed (SourceFile& file);
+	bool		readTokens();
+	void		lexInParallel (const String& fileName);
+	void		runLexingThread (ParallelLexing* state);
+	void		lexFile (FileTokens& file, ParallelLexing* state);
+	FileTokens*	queueFile (const String& fileName, ParallelLexing* state);
+	FileTokens*	queueIncludedFile (FileTokens& file, const Directive& directive, int& depth,
+					ParallelLexing* state);
+	void		listLexedFiles (ParallelLexing& state);
+	bool		loadCachedTokens (FileTokens& file, ParallelLexing* state);
+	void		storeCachedTokens (const FileTokens& file);
+	void		spliceTokens (FileTokens& file, ParallelLexing& state,
+					List<FileTokens*>& includeStack);
+	void		runLexerThread();
+	void		pushBatch();
+	void		addTokens (TokenBatch& batch);
+	bool		fetchTokens();
+	bool		fetchTokensUpTo (int pos);
+	void		discardOldTokens();
+	void		internSymbols (int begin);
+
+	static void	decodeOffset (SourceFile& file, int offset, int* line, int* column);
+	static TokenInfo makeToken (ETokenType type, SourceLocation location, int32_t payload,
+					const SourceFile& file, const List<String>& copiedTexts, int firstCopiedText);
+	static List<TokenInfo> directiveTokens (const SourceFile& file, const TokenBatch& batch,
+					const Directive& directive);
+	static void	addScannedToken (TokenBatch& batch, LexerScanner& sc, SourceLocation fileStart,
+					int& numCopiedTexts);
 
 	// read a mandatory token from scanner
 	void mustGetFromScanner (LexerScanner& sc, ETokenType tt =TK_Any);
 	void checkFileHeader (LexerScanner& sc);
 
-	static String describeTokenPrivate (ETokenType tok_type, TokenInfo* tok);
+	static String describeTokenPrivate (ETokenType tok_type, const TokenInfo* tok);
 };
 
 #endif // BOTC_LEXER_H
@@ -26,10 +26,23 @@
 	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#if defined (__AVX2__)
+# include <immintrin.h>
+#elif defined (__SSE2__)
+# include <emmintrin.h>
+#endif
+
 #include "lexerScanner.h"
 #include "lexer.h"
 
@@ -114,149 +127,431 @@ static const String gTokenStrings[] =
 static_assert (countof (gTokenStrings) == (int)gLastNamedToken + 1,
 	"Count of gTokenStrings is not the same as the amount of named token identifiers.");
 
+// =============================================================================
+//
+// Lookup tables used by getNextToken, built once from gTokenStrings so that
+// each token can be classified without trying every entry of it in turn.
+// Operators are indexed by their first character and sorted longest first so
+// that e.g. "<<=" wins over "<<" and "<". Named tokens are stored in a small
+// open-addressing hash table keyed by their spelling.
+//
+class TokenTables
+{
+public:
+	enum
+	{
+		MaxOperatorsPerChar = 4,
+		KeywordTableSize = 128,
+	};
+
+	TokenTables()
+	{
+		for (int i = 0; i < countof (gTokenStrings); ++i)
+			lengths[i] = gTokenStrings[i].length();
+
+		for (auto& ops : operators)
+			for (int& op : ops)
+				op = -1;
+
+		for (int i = 0; i < gFirstNamedToken; ++i)
+		{
+			int* ops = operators[(unsigned char) gTokenStrings[i][0]];
+			int n = 0;
+
+			while (ops[n] != -1)
+				++n;
+
+			ASSERT_LT (n, MaxOperatorsPerChar)
+
+			// Insertion sort by descending length
+			while (n > 0 && lengths[ops[n - 1]] < lengths[i])
+			{
+				ops[n] = ops[n - 1];
+				--n;
+			}
+
+			ops[n] = i;
+		}
+
+		for (int& kw : keywords)
+			kw = -1;
+
+		for (int i = gFirstNamedToken; i < countof (gTokenStrings); ++i)
+		{
+			unsigned slot = hash (gTokenStrings[i], lengths[i]) % KeywordTableSize;
+
+			while (keywords[slot] != -1)
+				slot = (slot + 1) % KeywordTableSize;
+
+			keywords[slot] = i;
+		}
+	}
+
+	// Returns the named token spelled by the @length characters at @word, or
+	// -1 if @word is not a keyword.
+	inline int findKeyword (const char* word, int length) const
+	{
+		unsigned slot = hash (word, length) % KeywordTableSize;
+
+		for (; keywords[slot] != -1; slot = (slot + 1) % KeywordTableSize)
+		{
+			int kw = keywords[slot];
+
+			if (lengths[kw] == length && strncmp (gTokenStrings[kw], word, length) == 0)
+				return kw;
+		}
+
+		return -1;
+	}
+
+	static inline unsigned hash (const char* word, int length)
+	{
+		unsigned result = 2166136261u;
+
+		for (int i = 0; i < length; ++i)
+			result = (result ^ (unsigned char) word[i]) * 16777619u;
+
+		return result;
+	}
+
+	int lengths[countof (gTokenStrings)];
+	int operators[256][MaxOperatorsPerChar + 1];
+	int keywords[KeywordTableSize];
+};
+
+static const TokenTables gTokenTables;
+
+// =============================================================================
+//
+// The skipping of whitespace, comments and string literals is vectorized when
+// SSE2 or AVX2 is available. The data is then read in aligned blocks which may
+// extend past the terminating null of the data; heap buffers are padded with
+// BufferPadding bytes for this, and mapped files always end on a page boundary.
+//
+enum
+{
+	BlockAlignment = 32,
+	BufferPadding = 2 * BlockAlignment,
+};
+
+#if defined (__AVX2__) || defined (__SSE2__)
+
+class ByteBlock
+{
+public:
+#if defined (__AVX2__)
+	enum { Width = 32 };
+	using Vector = __m256i;
+
+	inline ByteBlock (const char* data) :
+		m_bytes (_mm256_load_si256 (reinterpret_cast<const Vector*> (data))) {}
+
+	// Bit n of the result is set if byte n is @c
+	inline uint32_t equal (char c) const
+	{
+		return _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (m_bytes, _mm256_set1_epi8 (c)));
+	}
+
+	// Bit n of the result is set if byte n is within [@lo, @hi]
+	inline uint32_t inRange (char lo, char hi) const
+	{
+		Vector above = _mm256_cmpgt_epi8 (m_bytes, _mm256_set1_epi8 (lo - 1));
+		Vector below = _mm256_cmpgt_epi8 (_mm256_set1_epi8 (hi + 1), m_bytes);
+		return _mm256_movemask_epi8 (_mm256_and_si256 (above, below));
+	}
+#else
+	enum { Width = 16 };
+	using Vector = __m128i;
+
+	inline ByteBlock (const char* data) :
+		m_bytes (_mm_load_si128 (reinterpret_cast<const Vector*> (data))) {}
+
+	inline uint32_t equal (char c) const
+	{
+		return _mm_movemask_epi8 (_mm_cmpeq_epi8 (m_bytes, _mm_set1_epi8 (c)));
+	}
+
+	inline uint32_t inRange (char lo, char hi) const
+	{
+		Vector above = _mm_cmpgt_epi8 (m_bytes, _mm_set1_epi8 (lo - 1));
+		Vector below = _mm_cmpgt_epi8 (_mm_set1_epi8 (hi + 1), m_bytes);
+		return _mm_movemask_epi8 (_mm_and_si128 (above, below));
+	}
+#endif
+
+	static const uint32_t AllBytes = (Width == 32) ? ~0u : (1u << Width) - 1;
+
+private:
+	Vector m_bytes;
+};
+
+// =============================================================================
+//
+// Returns the first byte at or after @p for which @stops yields a set bit.
+// @stops must match the terminating null.
+//
+template<typename StopFunction>
+static inline const char* scanBlocks (const char* p, StopFunction stops)
+{
+	int misalignment = reinterpret_cast<uintptr_t> (p) % ByteBlock::Width;
+	const char* block = p - misalignment;
+	uint32_t validBytes = (ByteBlock::AllBytes << misalignment) & ByteBlock::AllBytes;
+
+	for (;; block += ByteBlock::Width, validBytes = ByteBlock::AllBytes)
+	{
+		ByteBlock bytes (block);
+		uint32_t stopMask = stops (bytes) & validBytes;
+
+		if (stopMask != 0)
+			return block + __builtin_ctz (stopMask);
+	}
+}
+
+#endif // __AVX2__ || __SSE2__
+
 // =============================================================================
 //
 LexerScanner::LexerScanner (FILE* fp) :
-	m_line (1)
+	m_buffer (null),
+	m_data (null),
+	m_dataSize (0),
+	m_isMapped (false)
 {
-	long fsize, bytes;
-
-	fseek (fp, 0l, SEEK_END);
-	fsize = ftell (fp);
-	rewind (fp);
-	m_data = new char[fsize];
-	m_position = m_lineBreakPosition = &m_data[0];
-	bytes = fread (m_data, 1, fsize, fp);
-	ASSERT_GT_EQ (bytes, fsize)
+	if (mapFile (fp) == false)
+		readFile (fp);
+
+	m_position = m_tokenStart = &m_data[0];
 }
 
 // =============================================================================
 //
 LexerScanner::~LexerScanner()
 {
-	delete m_data;
+#ifndef _WIN32
+	if (m_isMapped)
+	{
+		munmap (const_cast<char*> (m_data), m_dataSize + 1);
+		return;
+	}
+#endif
+
+	delete[] m_buffer;
 }
 
 // =============================================================================
 //
-bool LexerScanner::checkString (const char* c, int flags)
+// Maps the file straight from the page cache instead of copying it onto the
+// heap. The scanner relies on the data being null-terminated, so an anonymous
+// zero-filled region one byte larger than the file is reserved first and the
+// file is then mapped over it: the byte past the end of the file is thus
+// always a '\0', whether or not the file size is a multiple of the page size.
+//
+bool LexerScanner::mapFile (FILE* fp)
 {
-	bool r = strncmp (m_position, c, strlen (c)) == 0;
+#ifndef _WIN32
+	struct stat st;
+	int fd = fileno (fp);
 
-	// There is to be a non-symbol character after words
-	if (r && (flags & FCheckWord) && isSymbolChar (m_position[strlen (c)], true))
-		r = false;
+	if (fstat (fd, &st) == -1 || S_ISREG (st.st_mode) == false || st.st_size == 0)
+		return false;
+
+	long size = st.st_size;
+	void* region = mmap (null, size + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-	// Advance the cursor unless we want to just peek
-	if (r && !(flags & FCheckPeek))
-		m_position += strlen (c);
+	if (region == MAP_FAILED)
+		return false;
 
-	return r;
+	if (mmap (region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap (region, size + 1);
+		return false;
+	}
+
+	madvise (region, size, MADV_SEQUENTIAL);
+	m_data = static_cast<const char*> (region);
+	m_dataSize = size;
+	m_isMapped = true;
+	return true;
+#else
+	(void) fp;
+	return false;
+#endif
 }
 
 // =============================================================================
 //
-bool LexerScanner::getNextToken()
+// Fallback for input that cannot be mapped, e.g. pipes. The size of such input
+// is not known beforehand so the buffer is grown as data comes in. The data
+// is aligned within the buffer, which is padded for the vectorized scanning.
+//
+static char* alignedData (char* buffer)
 {
-	m_tokenText = "";
+	return buffer + (BlockAlignment - reinterpret_cast<uintptr_t> (buffer) % BlockAlignment);
+}
 
-	while (isspace (*m_position))
-		skip();
+void LexerScanner::readFile (FILE* fp)
+{
+	long allocated = 4096;
+	m_buffer = new char[allocated + BufferPadding];
+	char* data = alignedData (m_buffer);
+	size_t bytes;
 
-	// Check for comments
-	if (strncmp (m_position, "//", 2) == 0)
+	while ((bytes = fread (data + m_dataSize, 1, allocated - m_dataSize - 1, fp)) > 0)
 	{
-		m_position += 2;
-
-		while (*m_position != '\n')
-			skip();
+		m_dataSize += bytes;
 
-		return getNextToken();
+		if (m_dataSize + 1 == allocated)
+		{
+			char* newbuffer = new char[allocated * 2 + BufferPadding];
+			char* newdata = alignedData (newbuffer);
+			memcpy (newdata, data, m_dataSize);
+			delete[] m_buffer;
+			m_buffer = newbuffer;
+			data = newdata;
+			allocated *= 2;
+		}
 	}
-	elif (strncmp (m_position, "/*", 2) == 0)
+
+	if (ferror (fp))
+		error ("couldn't read input: %1", strerror (errno));
+
+	memset (data + m_dataSize, '\0', BlockAlignment);
+	m_data = data;
+}
+
+// =============================================================================
+//
+bool LexerScanner::getNextToken()
+{
+	m_tokenText = StringView();
+
+	// Skip whitespace and comments
+	for (;;)
 	{
-		skip (2); // skip the start symbols
+		m_position = skipBlanks (m_position);
+
+		if (m_position[0] != '/')
+			break;
 
-		while (strncmp (m_position, "*/", 2) != 0)
-			skip();
+		if (m_position[1] == '/')
+			m_position = findLineEnd (m_position + 2);
+		elif (m_position[1] == '*')
+		{
+			m_position = findCommentEnd (m_position + 2);
 
-		skip (2); // skip the end symbols
-		return getNextToken();
+			if (*m_position == '\0')
+				error ("unterminated comment");
+
+			m_position += 2; // skip the end symbols
+		}
+		else
+			break;
 	}
 
+	m_tokenStart = m_position;
+
 	if (*m_position == '\0')
 		return false;
 
-	// Check tokens
-	for (int i = 0; i < countof (gTokenStrings); ++i)
+	// Check operators, dispatched by their first character
+	for (const int* op = gTokenTables.operators[(unsigned char) *m_position]; *op != -1; ++op)
 	{
-		int flags = 0;
-
-		if (i >= gFirstNamedToken)
-			flags |= FCheckWord;
+		int length = gTokenTables.lengths[*op];
 
-		if (checkString (gTokenStrings[i], flags))
+		if (strncmp (m_position, gTokenStrings[*op], length) == 0)
 		{
-			m_tokenText = gTokenStrings[i];
-			m_tokenType = (ETokenType) i;
+			m_tokenText = StringView (m_position, length);
+			m_tokenType = (ETokenType) *op;
+			m_position += length;
 			return true;
 		}
 	}
 
-	// Check and parse string
+	// Check and parse string. Strings without escape sequences are referred
+	// to directly in the source; only the rest are unescaped into a buffer.
 	if (*m_position == '\"')
 	{
-		m_position++;
+		const char* start = ++m_position;
+		String* unescaped = null;
 
-		while (*m_position != '\"')
+		for (;;)
 		{
-			if (!*m_position)
+			const char* end = findStringEnd (m_position);
+
+			if (*end == '\0')
 				error ("unterminated string");
 
-			if (checkString ("\\n"))
+			if (unescaped != null)
+				unescaped->append (m_position, end - m_position);
+
+			m_position = end + 1;
+
+			if (*end == '\"')
+				break;
+
+			// Backslash, check for an escape sequence
+			char escaped = '\0';
+
+			switch (*m_position)
 			{
-				m_tokenText += '\n';
-				continue;
+				case 'n':	escaped = '\n'; break;
+				case 't':	escaped = '\t'; break;
+				case '"':	escaped = '"'; break;
 			}
-			elif (checkString ("\\t"))
+
+			if (escaped == '\0')
 			{
-				m_tokenText += '\t';
+				// Not an escape sequence, the backslash is kept as is
+				if (unescaped != null)
+					*unescaped += '\\';
+
 				continue;
 			}
-			elif (checkString ("\\\""))
+
+			if (unescaped == null)
 			{
-				m_tokenText += '"';
-				continue;
+				unescaped = &m_unescapedString;
+				*unescaped = String (start, end - start);
 			}
 
-			m_tokenText += *m_position++;
+			*unescaped += escaped;
+			m_position++;
 		}
 
+		if (unescaped != null)
+			m_tokenText = StringView (*unescaped);
+		else
+			m_tokenText = StringView (start, m_position - 1 - start);
+
 		m_tokenType =TK_String;
-		skip(); // skip the final quote
 		return true;
 	}
 
 	if (isdigit (*m_position))
 	{
+		const char* start = m_position;
+
 		while (isdigit (*m_position))
-			m_tokenText += *m_position++;
+			m_position++;
 
+		m_tokenText = StringView (start, m_position - start);
 		m_tokenType =TK_Number;
 		return true;
 	}
 
 	if (isSymbolChar (*m_position, false))
 	{
-		m_tokenType =TK_Symbol;
+		const char* start = m_position;
 
-		do
-		{
-			if (!isSymbolChar (*m_position, true))
-				break;
+		while (isSymbolChar (*m_position, true))
+			m_position++;
+
+		// Words are symbols unless they spell out a named token
+		int length = m_position - start;
+		int keyword = gTokenTables.findKeyword (start, length);
 
-			m_tokenText += *m_position++;
-		} while (*m_position != '\0');
+		m_tokenText = StringView (start, length);
+		m_tokenType = (keyword != -1) ? (ETokenType) keyword : TK_Symbol;
 
 		return true;
 	}
@@ -267,23 +562,79 @@ bool LexerScanner::getNextToken()
 
 // =============================================================================
 //
-void LexerScanner::skip()
+const char* LexerScanner::skipBlanks (const char* p)
 {
-	if (*m_position == '\n')
+#if defined (__AVX2__) || defined (__SSE2__)
+	// isspace() is true for ' ' and '\t' through '\r'
+	return scanBlocks (p, [] (const ByteBlock& bytes)
 	{
-		m_line++;
-		m_lineBreakPosition = m_position;
-	}
+		return ~(bytes.equal (' ') | bytes.inRange ('\t', '\r')) & ByteBlock::AllBytes;
+	});
+#else
+	while (isspace (*p))
+		++p;
+
+	return p;
+#endif
+}
 
-	m_position++;
+// =============================================================================
+//
+const char* LexerScanner::findLineEnd (const char* p)
+{
+#if defined (__AVX2__) || defined (__SSE2__)
+	return scanBlocks (p, [] (const ByteBlock& bytes)
+	{
+		return bytes.equal ('\n') | bytes.equal ('\0');
+	});
+#else
+	while (*p != '\n' && *p != '\0')
+		++p;
+
+	return p;
+#endif
 }
 
 // =============================================================================
 //
-void LexerScanner::skip (int chars)
+// Returns the position of the "*/" ending a block comment.
+//
+const char* LexerScanner::findCommentEnd (const char* p)
 {
-	for (int i = 0; i < chars; ++i)
-		skip();
+	for (;; ++p)
+	{
+#if defined (__AVX2__) || defined (__SSE2__)
+		p = scanBlocks (p, [] (const ByteBlock& bytes)
+		{
+			return bytes.equal ('*') | bytes.equal ('\0');
+		});
+#else
+		while (*p != '*' && *p != '\0')
+			++p;
+#endif
+
+		if (*p == '\0' || p[1] == '/')
+			return p;
+	}
+}
+
+// =============================================================================
+//
+// Returns the position of the next quote or backslash in a string literal.
+//
+const char* LexerScanner::findStringEnd (const char* p)
+{
+#if defined (__AVX2__) || defined (__SSE2__)
+	return scanBlocks (p, [] (const ByteBlock& bytes)
+	{
+		return bytes.equal ('"') | bytes.equal ('\\') | bytes.equal ('\0');
+	});
+#else
+	while (*p != '"' && *p != '\\' && *p != '\0')
+		++p;
+
+	return p;
+#endif
 }
 
 // =============================================================================
@@ -300,8 +651,40 @@ String LexerScanner::readLine()
 {
 	String line;
 
-	while (*m_position != '\n')
+	while (*m_position != '\n' && *m_position != '\0')
 		line += *(m_position++);
 
 	return line;
 }
+
+// =============================================================================
+//
+// Returns true if there are no more tokens on the current line. A block comment
+// that goes on to the next line ends the line as well.
+//
+bool LexerScanner::isAtLineEnd() const
+{
+	const char* p = m_position;
+
+	for (;;)
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r')
+			p++;
+
+		if (p[0] == '/' && p[1] == '*')
+		{
+			p += 2;
+
+			while (*p != '\0' && *p != '\n' && (p[0] != '*' || p[1] != '/'))
+				p++;
+
+			if (*p == '\0' || *p == '\n')
+				return true;
+
+			p += 2;
+			continue;
+		}
+
+		return *p == '\n' || *p == '\0' || (p[0] == '/' && p[1] == '/');
+	}
+}
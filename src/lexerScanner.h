@@ -35,19 +35,6 @@
 class LexerScanner
 {
 public:
-	struct PositionInfo
-	{
-		char*	pos;
-		int		line;
-	};
-
-	// Flags for check_string()
-	enum
-	{
-		FCheckWord = (1 << 0),   // must be followed by whitespace
-		FCheckPeek = (1 << 1),   // don't advance cursor
-	};
-
 	static inline bool isSymbolChar (char c, bool allownumbers)
 	{
 		if (allownumbers && (c >= '0' && c <= '9'))
@@ -62,20 +49,36 @@ public:
 	~LexerScanner();
 	bool getNextToken();
 	String readLine();
+	bool isAtLineEnd() const;
 
-	inline const String& getTokenText() const
+	// The returned view stays valid for as long as the scanner does, except
+	// for unescaped string literals, which only last until the next token.
+	inline StringView getTokenText() const
 	{
 		return m_tokenText;
 	}
 
-	inline int getLine() const
+	// True if the token text is an unescaped copy instead of a part of the
+	// source data.
+	inline bool isTokenTextCopied() const
+	{
+		return m_tokenText.data() < m_data || m_tokenText.data() > m_data + m_dataSize;
+	}
+
+	// Offset of the first character of the current token within the data.
+	inline int getTokenOffset() const
+	{
+		return m_tokenStart - m_data;
+	}
+
+	inline const char* getData() const
 	{
-		return m_line;
+		return m_data;
 	}
 
-	inline int getColumn() const
+	inline long getDataSize() const
 	{
-		return m_position - m_lineBreakPosition;
+		return m_dataSize;
 	}
 
 	inline ETokenType getTokenType() const
@@ -86,27 +89,29 @@ public:
 	static String getTokenString (ETokenType a);
 
 private:
-	char*			m_data;
-	char*			m_position;
-	char*			m_lineBreakPosition;
-	String			m_tokenText,
-					m_lastToken;
+	char*			m_buffer;
+	const char*		m_data;
+	long			m_dataSize;
+	bool			m_isMapped;
+	const char*		m_position;
+	const char*		m_tokenStart;
+	StringView		m_tokenText;
+	String			m_unescapedString;
 	ETokenType		m_tokenType;
-	int				m_line;
-
-	bool			checkString (const char* c, int flags = 0);
-
-	// Yields a copy of the current position information.
-	PositionInfo	getPosition() const;
 
-	// Sets the current position based on given data.
-	void			setPosition (const PositionInfo& a);
+	// Maps the file into memory. Returns false if the file cannot be mapped
+	// (e.g. it is a pipe), in which case readFile() should be used instead.
+	bool			mapFile (FILE* fp);
 
-	// Skips one character
-	void			skip();
+	// Reads the whole file into a heap buffer.
+	void			readFile (FILE* fp);
 
-	// Skips many characters
-	void			skip (int chars);
+	// Each of these returns the first character at or after @p that they
+	// stop at. They always stop at the terminating null.
+	const char*		skipBlanks (const char* p);
+	const char*		findLineEnd (const char* p);
+	const char*		findCommentEnd (const char* p);
+	const char*		findStringEnd (const char* p);
 };
 
 #endif // BOTC_LEXER_SCANNER_H
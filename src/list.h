@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <deque>
 #include <initializer_list>
+#include <utility>
 
 template<typename T>
 class List
@@ -45,9 +46,11 @@ public:
 
 	List();
 	List (const std::deque<T>& a);
+	List (std::deque<T>&& a);
 	List (std::initializer_list<T>&& a);
 
 	inline T&						append (const T& value);
+	inline T&						append (T&& value);
 	inline Iterator					begin();
 	inline ConstIterator			begin() const;
 	inline void						clear();
@@ -60,11 +63,13 @@ public:
 	int								find (const T& needle) const;
 	inline const T&					first() const;
 	inline void						insert (int pos, const T& value);
+	inline void						insert (int pos, T&& value);
 	inline bool						isEmpty() const;
 	inline const T&					last() const;
 	void							merge (const List<T>& other);
 	bool							pop (T& val);
 	inline T&						prepend (const T& value);
+	inline T&						prepend (T&& value);
 	inline ReverseIterator			rbegin();
 	inline void						removeAt (int pos);
 	void							removeDuplicates();
@@ -77,10 +82,12 @@ public:
 	List<T>							splice (int a, int b) const;
 
 	inline List<T>&					operator<< (const T& value);
+	inline List<T>&					operator<< (T&& value);
 	inline List<T>&					operator<< (const List<T>& vals);
 	inline T&						operator[] (int n);
 	inline const T&					operator[] (int n) const;
-	inline List<T>					operator+ (const List<T>& other) const;
+	inline List<T>					operator+ (const List<T>& other) const &;
+	inline List<T>					operator+ (const List<T>& other) &&;
 
 private:
 	std::deque<T> _deque;
@@ -100,6 +107,10 @@ template<typename T>
 List<T>::List (const std::deque<T>& other) :
 	_deque (other) {}
 
+template<typename T>
+List<T>::List (std::deque<T>&& other) :
+	_deque (std::move (other)) {}
+
 template<typename T>
 List<T>::List (std::initializer_list<T>&& a) :
 	_deque (a) {}
@@ -166,6 +177,13 @@ inline T& List<T>::prepend (const T& value)
 	return _deque[0];
 }
 
+template<typename T>
+inline T& List<T>::prepend (T&& value)
+{
+	_deque.push_front (std::move (value));
+	return _deque[0];
+}
+
 template<typename T>
 inline T& List<T>::append (const T& value)
 {
@@ -173,11 +191,19 @@ inline T& List<T>::append (const T& value)
 	return _deque[_deque.size() - 1];
 }
 
+template<typename T>
+inline T& List<T>::append (T&& value)
+{
+	_deque.push_back (std::move (value));
+	return _deque[_deque.size() - 1];
+}
+
 template<typename T>
 void List<T>::merge (const List<T>& other)
 {
-	resize (size() + other.size());
-	std::copy (other.begin(), other.end(), begin() + other.size());
+	int oldsize = size();
+	resize (oldsize + other.size());
+	std::copy (other.begin(), other.end(), begin() + oldsize);
 }
 
 template<typename T>
@@ -186,7 +212,7 @@ bool List<T>::pop (T& val)
 	if (isEmpty())
 		return false;
 
-	val = _deque[size() - 1];
+	val = std::move (_deque[size() - 1]);
 	_deque.erase (_deque.end() - 1);
 	return true;
 }
@@ -198,6 +224,13 @@ inline List<T>& List<T>::operator<< (const T& value)
 	return *this;
 }
 
+template<typename T>
+inline List<T>& List<T>::operator<< (T&& value)
+{
+	append (std::move (value));
+	return *this;
+}
+
 template<typename T>
 inline List<T>& List<T>::operator<< (const List<T>& vals)
 {
@@ -225,6 +258,12 @@ inline void List<T>::insert (int pos, const T& value)
 	_deque.insert (_deque.begin() + pos, value);
 }
 
+template<typename T>
+inline void List<T>::insert (int pos, T&& value)
+{
+	_deque.insert (_deque.begin() + pos, std::move (value));
+}
+
 template<typename T>
 void List<T>::removeDuplicates()
 {
@@ -329,13 +368,21 @@ inline bool List<T>::contains (const T& a) const
 }
 
 template<typename T>
-inline List<T> List<T>::operator+ (const List<T>& other) const
+inline List<T> List<T>::operator+ (const List<T>& other) const &
 {
 	List<T> out (*this);
 	out.merge (other);
 	return out;
 }
 
+// A temporary on the left, like in a + b + c, is added to in place.
+template<typename T>
+inline List<T> List<T>::operator+ (const List<T>& other) &&
+{
+	merge (other);
+	return std::move (*this);
+}
+
 template<typename T>
 List<T>& operator>> (const T& value, List<T>& haystack)
 {
@@ -29,29 +29,92 @@
 #include "main.h"
 #include "events.h"
 #include "commands.h"
-#include "stringTable.h"
+#include "compilerContext.h"
 #include "dataBuffer.h"
 #include "parser.h"
 #include "lexer.h"
+#include "builtins.h"
+#include "module.h"
 #include "gitinfo.h"
 
 int main (int argc, char** argv)
 {
+	CompilerContext context;
+	CompilerContext::Scope contextScope (&context);
+	BotscriptParser* parser = null;
+
 	try
 	{
 		// Intepret command-line parameters:
 		// -l: list commands
-		// I guess there should be a better way to do this.
-		if (argc == 2 && String (argv[1]) == "-l")
+		// --stream: lex the script as it is parsed instead of all at once
+		// --pipeline: lex the script in a separate thread while it is parsed
+		// --no-cache: don't use or update the token cache
+		// --builtin-defs: use the definitions built into botc, don't read botc_defs.bts
+		// --precompile: compile the declarations of the script into a module, see module.h
+		// --check: only check the script for errors, don't generate any code
+		// --write-builtin-defs <file>: write the definitions of botc_defs.bts to <file> as
+		//     tables to build botc with, see builtins.h
+		// -o <file>: write the output to <file>
+		// -I <dir>: look for included files in <dir> too
+		// -D <name>[=<value>]: #define <name> as <value>, or 1
+		StringList args;
+		StringList includeDirectories;
+		StringList defines;
+		bool streaming = false;
+		bool pipelined = false;
+		bool caching = true;
+		bool builtinDefinitions = false;
+		bool precompiling = false;
+		bool checking = false;
+		String outfile;
+		String builtinsOutfile;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			if (String (argv[i]) == "--stream")
+				streaming = true;
+			elif (String (argv[i]) == "--pipeline")
+				pipelined = true;
+			elif (String (argv[i]) == "--no-cache")
+				caching = false;
+			elif (String (argv[i]) == "--builtin-defs")
+				builtinDefinitions = true;
+			elif (String (argv[i]) == "--precompile")
+				precompiling = true;
+			elif (String (argv[i]) == "--check")
+				checking = true;
+			elif (String (argv[i]) == "--write-builtin-defs" && i + 1 < argc)
+				builtinsOutfile = argv[++i];
+			elif (String (argv[i]) == "-o" && i + 1 < argc)
+				outfile = argv[++i];
+			elif (String (argv[i]) == "-I" && i + 1 < argc)
+				includeDirectories << argv[++i];
+			elif (String (argv[i]).startsWith ("-I") && String (argv[i]).length() > 2)
+				includeDirectories << String (argv[i]).mid (2);
+			elif (String (argv[i]) == "-D" && i + 1 < argc)
+				defines << argv[++i];
+			elif (String (argv[i]).startsWith ("-D") && String (argv[i]).length() > 2)
+				defines << String (argv[i]).mid (2);
+			else
+				args << argv[i];
+		}
+
+		if (args.size() == 1 && args[0] == "-l")
 		{
 			print ("Begin list of commands:\n");
 			print ("------------------------------------------------------\n");
 
-			BotscriptParser parser;
-			parser.setReadOnly (true);
-			parser.parseBotscript ("botc_defs.bts");
+			if (builtinDefinitions)
+				preloadBuiltinDefinitions (&context);
+			else
+			{
+				BotscriptParser parser (&context);
+				parser.setReadOnly (true);
+				parser.parseBotscript ("botc_defs.bts");
+			}
 
-			for (CommandInfo* comm : getCommands())
+			for (CommandInfo* comm : context.commands())
 				print ("%1\n", comm->signature());
 
 			print ("------------------------------------------------------\n");
@@ -59,10 +122,23 @@ int main (int argc, char** argv)
 			exit (0);
 		}
 
-		if (argc < 2)
+		if (builtinsOutfile.isEmpty() == false)
 		{
-			fprintf (stderr, "usage: %s <infile> [outfile] # compiles botscript\n", argv[0]);
-			fprintf (stderr, "       %s -l                 # lists commands\n", argv[0]);
+			String fileName = args.isEmpty() ? "botc_defs.bts" : args[0];
+			BotscriptParser parser (&context);
+			parser.setReadOnly (true);
+			parser.parseBotscript (fileName);
+			writeBuiltinDefinitions (&context, fileName, builtinsOutfile);
+			exit (0);
+		}
+
+		if (args.isEmpty())
+		{
+			fprintf (stderr, "usage: %s [--stream] [--pipeline] [--no-cache] [--builtin-defs] [-I <dir>]... [-D <name>[=<value>]]... [-o <outfile>] <infile> [outfile] # compiles botscript\n", argv[0]);
+			fprintf (stderr, "       %s --precompile [--builtin-defs] [-I <dir>]... [-D <name>[=<value>]]... [-o <outfile>] <infile>                                     # makes a module\n", argv[0]);
+			fprintf (stderr, "       %s --check [--builtin-defs] [-I <dir>]... [-D <name>[=<value>]]... <infile>                                                       # checks for errors\n", argv[0]);
+			fprintf (stderr, "       %s [--builtin-defs] -l                                                                                                            # lists commands\n", argv[0]);
+			fprintf (stderr, "       %s --write-builtin-defs <outfile> [<infile>]                                                                                      # makes builtin tables\n", argv[0]);
 			exit (1);
 		}
 
@@ -96,37 +172,88 @@ int main (int argc, char** argv)
 		headerline += '-';
 		print ("%2\n\n%1\n\n%2\n\n", header, headerline);
 
-		String outfile;
+		if (checking && precompiling)
+			error ("--check and --precompile cannot be used together");
 
-		if (argc < 3)
-			outfile = makeObjectFileName (argv[1]);
-		else
-			outfile = argv[2];
+		if (outfile.isEmpty())
+		{
+			if (args.size() >= 2)
+				outfile = args[1];
+			elif (precompiling)
+				outfile = Module::moduleFileName (args[0]);
+			else
+				outfile = makeObjectFileName (args[0]);
+		}
+
+		// When only checking, the buffers must discard their contents from the
+		// very first one the parser creates.
+		context.setDiscarding (checking);
 
 		// Prepare reader and writer
-		BotscriptParser* parser = new BotscriptParser;
+		parser = new BotscriptParser (&context);
+		parser->setReadOnly (precompiling);
+		parser->lexer()->setStreaming (streaming);
+		parser->lexer()->setPipelined (pipelined);
+		parser->lexer()->setCaching (caching);
+
+		if (builtinDefinitions)
+		{
+			preloadBuiltinDefinitions (&context);
+			parser->lexer()->setHasBuiltinDefinitions (true);
+		}
+
+		for (const String& directory : includeDirectories)
+			parser->lexer()->includeResolver().addSearchDirectory (directory);
+
+		for (const String& define : defines)
+		{
+			int equals = define.firstIndexOf ("=");
+			bool ok = true;
+			long value = (equals == -1) ? 1 : define.mid (equals + 1).toLong (&ok);
+
+			if (ok == false)
+				error ("bad value in -D%1, expected a number", define);
+
+			parser->lexer()->define ((equals == -1) ? define : define.mid (0, equals), value);
+		}
 
 		// We're set, begin parsing :)
 		print ("Parsing script...\n");
-		parser->parseBotscript (argv[1]);
+		parser->parseBotscript (args[0]);
 		print ("Script parsed successfully.\n");
 
+		if (precompiling)
+		{
+			parser->writeModule (outfile);
+			delete parser;
+			return 0;
+		}
+
 		// Parse done, print statistics and write to file
 		int globalcount = parser->getHighestVarIndex (true) + 1;
 		int statelocalcount = parser->getHighestVarIndex (false) + 1;
-		int stringcount = countStringsInTable();
-		print ("%1 / %2 strings\n", stringcount, gMaxStringlistSize);
+		int stringcount = context.stringTable().count();
+
+		// Strings are not put in the table when checking, so their count is
+		// not known.
+		if (checking == false)
+			print ("%1 / %2 strings\n", stringcount, gMaxStringlistSize);
+
 		print ("%1 / %2 global variable indices\n", globalcount, gMaxGlobalVars);
 		print ("%1 / %2 state variable indices\n", statelocalcount, gMaxGlobalVars);
 		print ("%1 / %2 events\n", parser->numEvents(), gMaxEvents);
 		print ("%1 state%s1\n", parser->numStates());
 
-		parser->writeToFile (outfile);
+		if (checking == false)
+			parser->writeToFile (outfile);
+
 		delete parser;
 		return 0;
 	}
 	catch (std::exception& e)
 	{
+		// Deleting the parser stops the lexer thread, if there is one
+		delete parser;
 		fprintf (stderr, "error: %s\n", e.what());
 		return 1;
 	}
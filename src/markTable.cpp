@@ -0,0 +1,83 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "markTable.h"
+
+// =============================================================================
+//
+ByteMark MarkTable::addMark (DataSegment* segment, int pos)
+{
+	Mark mark;
+	mark.segment = segment;
+	mark.pos = pos;
+	m_marks << mark;
+	return ByteMark (m_marks.size() - 1);
+}
+
+// =============================================================================
+//
+int32_t MarkTable::addReference (ByteMark target, DataSegment* segment, int pos)
+{
+	Reference ref;
+	ref.segment = segment;
+	ref.pos = pos;
+	ref.target = target;
+	ref.next = -1;
+	m_references << ref;
+	return m_references.size() - 1;
+}
+
+// =============================================================================
+//
+// Returns the position of @pos bytes into @segment within the outermost
+// segment it has been merged into, which must be @root. The segments on the
+// way are pointed straight at @root so that the next lookup is quick.
+//
+int MarkTable::resolve (DataSegment* segment, int pos, DataSegment* root)
+{
+	int offset = 0;
+	DataSegment* outermost = segment;
+
+	for (; outermost->parent != null; outermost = outermost->parent)
+		offset += outermost->offset;
+
+	ASSERT_EQ (outermost, root);
+	int result = pos + offset;
+
+	while (segment != outermost)
+	{
+		DataSegment* parent = segment->parent;
+		int rest = offset - segment->offset;
+		segment->parent = outermost;
+		segment->offset = offset;
+		offset = rest;
+		segment = parent;
+	}
+
+	return result;
+}
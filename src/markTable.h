@@ -0,0 +1,91 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_MARK_TABLE_H
+#define BOTC_MARK_TABLE_H
+
+#include "main.h"
+
+// =============================================================================
+//
+// The bytes that were written to a single data buffer. Once that buffer is
+// merged into another, they lie @offset bytes into the segment of @parent.
+//
+struct DataSegment
+{
+	DataSegment*	parent;
+	int				offset;
+};
+
+// =============================================================================
+//
+// The marks and references of a compilation. Both are kept in pools and are
+// referred to by index, see ByteMark. Their positions are relative to the
+// segment of the buffer they were made in, so merging buffers never has to
+// touch them.
+//
+// The references of a buffer are chained through @next, which is -1 at the
+// end of the chain.
+//
+class MarkTable
+{
+	public:
+		struct Mark
+		{
+			DataSegment*	segment;
+			int32_t			pos;
+		};
+
+		struct Reference
+		{
+			DataSegment*	segment;
+			int32_t			pos;
+			ByteMark		target;
+			int32_t			next;
+		};
+
+		ByteMark			addMark (DataSegment* segment, int pos);
+		int32_t				addReference (ByteMark target, DataSegment* segment, int pos);
+		static int			resolve (DataSegment* segment, int pos, DataSegment* root);
+
+		inline Mark& mark (ByteMark handle)
+		{
+			return m_marks[handle.index];
+		}
+
+		inline Reference& reference (int32_t index)
+		{
+			return m_references[index];
+		}
+
+	private:
+		List<Mark>			m_marks;
+		List<Reference>		m_references;
+};
+
+#endif // BOTC_MARK_TABLE_H
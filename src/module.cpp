@@ -0,0 +1,498 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "module.h"
+#include "dataReader.h"
+
+// =============================================================================
+//
+// Starts a module file. @compiler is the key of no source at all, which tells
+// the version of botc that made the module. The header is followed by the
+// dependencies, the initial and final defines, the commands, the events, the
+// variables and finally the strings. Each command, event and variable is
+// followed by the index of the dependency it was declared in.
+//
+struct Module::Header
+{
+	char				magic[8];
+	uint32_t			formatVersion;
+	TokenCache::Key		compiler;
+	uint32_t			hasBuiltinDefinitions;
+	int32_t				zandronumVersion;
+	uint32_t			numDependencies;
+	uint32_t			numInitialDefines;
+	uint32_t			numDefines;
+	uint32_t			numCommands;
+	uint32_t			numEvents;
+	uint32_t			numVariables;
+	uint32_t			numStrings;
+};
+
+static const char ModuleFileMagic[8] = { 'B', 'O', 'T', 'C', 'M', 'O', 'D', 'L' };
+
+// =============================================================================
+//
+// Computes the key of the contents of the file at @path. Returns false if the
+// file cannot be read.
+//
+static bool makeFileKey (const String& path, TokenCache::Key& key)
+{
+	FILE* fp = fopen (path, "rb");
+
+	if (fp == null)
+		return false;
+
+	std::string data;
+	char buffer[4096];
+	size_t length;
+
+	while ((length = fread (buffer, 1, sizeof buffer, fp)) > 0)
+		data.append (buffer, length);
+
+	bool isRead = ferror (fp) == 0;
+	fclose (fp);
+
+	if (isRead)
+		key = TokenCache::makeKey (data.data(), data.size());
+
+	return isRead;
+}
+
+// =============================================================================
+//
+Module* Module::load (const String& path)
+{
+#ifdef _WIN32
+	return null;
+#else
+	int fd = open (path, O_RDONLY);
+
+	if (fd == -1)
+		return null;
+
+	struct stat st;
+
+	if (fstat (fd, &st) != 0 || st.st_size < (off_t) sizeof (Header))
+	{
+		close (fd);
+		return null;
+	}
+
+	void* data = mmap (null, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+
+	if (data == MAP_FAILED)
+		return null;
+
+	DataReader reader ((const char*) data, st.st_size);
+	TokenCache::Key compiler = TokenCache::makeKey ("", 0);
+	Header header;
+	bool isValid = reader.read (&header, sizeof header)
+		&& memcmp (header.magic, ModuleFileMagic, sizeof header.magic) == 0
+		&& header.formatVersion == FormatVersion
+		&& memcmp (&header.compiler, &compiler, sizeof compiler) == 0;
+
+	if (isValid == false)
+	{
+		munmap (data, st.st_size);
+		return null;
+	}
+
+	Module* module = new Module;
+	module->path = path;
+	module->hasBuiltinDefinitions = header.hasBuiltinDefinitions != 0;
+	module->zandronumVersion = header.zandronumVersion;
+
+	auto readInt = [&reader] (int& value) -> bool
+	{
+		int32_t data = 0;
+		bool result = reader.read (&data, sizeof data);
+		value = data;
+		return result;
+	};
+
+	auto readType = [&readInt] (DataType& type) -> bool
+	{
+		int value = 0;
+		bool result = readInt (value) && value >= TYPE_Unknown && value <= TYPE_Bool;
+		type = (DataType) value;
+		return result;
+	};
+
+	auto readSource = [&] (List<int>& sources) -> bool
+	{
+		int source = 0;
+		bool result = readInt (source) && source >= 0 && source < module->dependencies.size();
+		sources << source;
+		return result;
+	};
+
+	auto readDefines = [&] (uint32_t count, std::map<String, int>& defines) -> bool
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			String name;
+			int value = 0;
+
+			if (reader.readString (name) == false || readInt (value) == false)
+				return false;
+
+			defines[name] = value;
+		}
+
+		return true;
+	};
+
+	for (uint32_t i = 0; i < header.numDependencies && isValid; ++i)
+	{
+		Dependency dependency;
+		isValid = reader.readString (dependency.path)
+			&& reader.read (&dependency.key, sizeof dependency.key);
+		module->dependencies << dependency;
+	}
+
+	isValid = isValid
+		&& module->dependencies.isEmpty() == false
+		&& readDefines (header.numInitialDefines, module->initialDefines)
+		&& readDefines (header.numDefines, module->defines);
+
+	for (uint32_t i = 0; i < header.numCommands && isValid; ++i)
+	{
+		CommandInfo comm;
+		int numArgs = 0;
+		isValid = reader.readString (comm.name)
+			&& readInt (comm.number)
+			&& readInt (comm.minargs)
+			&& readType (comm.returnvalue)
+			&& readInt (numArgs)
+			&& numArgs >= comm.minargs && comm.minargs >= 0;
+
+		for (int j = 0; j < numArgs && isValid; ++j)
+		{
+			CommandArgument arg;
+			isValid = readType (arg.type) && reader.readString (arg.name) && readInt (arg.defvalue);
+			comm.args << arg;
+		}
+
+		module->commands << comm;
+		isValid = isValid && readSource (module->commandSources);
+	}
+
+	for (uint32_t i = 0; i < header.numEvents && isValid; ++i)
+	{
+		EventDefinition e;
+		isValid = reader.readString (e.name) && readInt (e.number)
+			&& readSource (module->eventSources);
+		module->events << e;
+	}
+
+	for (uint32_t i = 0; i < header.numVariables && isValid; ++i)
+	{
+		Variable var;
+		int writelevel = 0;
+		int isarray = 0;
+		isValid = reader.readString (var.name)
+			&& readType (var.type)
+			&& readInt (writelevel)
+			&& writelevel >= WRITE_Mutable && writelevel <= WRITE_Constexpr
+			&& readInt (var.value)
+			&& readInt (isarray)
+			&& readSource (module->variableSources);
+		var.writelevel = (Writability) writelevel;
+		var.isarray = isarray != 0;
+		var.statename = "";
+		var.index = -1;
+		module->variables << var;
+	}
+
+	for (uint32_t i = 0; i < header.numStrings && isValid; ++i)
+	{
+		String text;
+		isValid = reader.readString (text);
+		module->strings << text;
+	}
+
+	// String constants refer to the strings of the module
+	for (const Variable& var : module->variables)
+	{
+		if (var.type == TYPE_String && var.writelevel == WRITE_Constexpr)
+			isValid = isValid && var.value >= 0 && var.value < module->strings.size();
+	}
+
+	munmap (data, st.st_size);
+
+	if (isValid == false || reader.remaining() != 0)
+	{
+		delete module;
+		return null;
+	}
+
+	return module;
+#endif
+}
+
+// =============================================================================
+//
+void Module::write (const String& path) const
+{
+	std::string data;
+	auto put = [&data] (const void* value, long length)
+	{
+		data.append ((const char*) value, length);
+	};
+
+	auto putInt = [&put] (int value)
+	{
+		int32_t data = value;
+		put (&data, sizeof data);
+	};
+
+	auto putString = [&put] (const String& str)
+	{
+		uint32_t length = str.length();
+		put (&length, sizeof length);
+		put (str.chars(), length);
+	};
+
+	Header header;
+	memset (&header, 0, sizeof header);
+	memcpy (header.magic, ModuleFileMagic, sizeof header.magic);
+	header.formatVersion = FormatVersion;
+	header.compiler = TokenCache::makeKey ("", 0);
+	header.hasBuiltinDefinitions = hasBuiltinDefinitions;
+	header.zandronumVersion = zandronumVersion;
+	header.numDependencies = dependencies.size();
+	header.numInitialDefines = initialDefines.size();
+	header.numDefines = defines.size();
+	header.numCommands = commands.size();
+	header.numEvents = events.size();
+	header.numVariables = variables.size();
+	header.numStrings = strings.size();
+	put (&header, sizeof header);
+
+	for (const Dependency& dependency : dependencies)
+	{
+		putString (dependency.path);
+		put (&dependency.key, sizeof dependency.key);
+	}
+
+	for (const std::map<String, int>* map : { &initialDefines, &defines })
+	{
+		for (const auto& define : *map)
+		{
+			putString (define.first);
+			putInt (define.second);
+		}
+	}
+
+	for (int i = 0; i < commands.size(); ++i)
+	{
+		const CommandInfo& comm = commands[i];
+		putString (comm.name);
+		putInt (comm.number);
+		putInt (comm.minargs);
+		putInt (comm.returnvalue);
+		putInt (comm.args.size());
+
+		for (const CommandArgument& arg : comm.args)
+		{
+			putInt (arg.type);
+			putString (arg.name);
+			putInt (arg.defvalue);
+		}
+
+		putInt (commandSources[i]);
+	}
+
+	for (int i = 0; i < events.size(); ++i)
+	{
+		putString (events[i].name);
+		putInt (events[i].number);
+		putInt (eventSources[i]);
+	}
+
+	for (int i = 0; i < variables.size(); ++i)
+	{
+		const Variable& var = variables[i];
+		putString (var.name);
+		putInt (var.type);
+		putInt (var.writelevel);
+		putInt (var.value);
+		putInt (var.isarray);
+		putInt (variableSources[i]);
+	}
+
+	for (const String& text : strings)
+		putString (text);
+
+	FILE* fp = fopen (path, "wb");
+
+	if (fp == null)
+		error ("couldn't open %1 for writing: %2", path, strerror (errno));
+
+	bool isWritten = fwrite (data.data(), 1, data.size(), fp) == data.size();
+
+	if (fclose (fp) != 0 || isWritten == false)
+		error ("couldn't write %1: %2", path, strerror (errno));
+}
+
+// =============================================================================
+//
+bool Module::isUpToDate() const
+{
+	for (const Dependency& dependency : dependencies)
+	{
+		TokenCache::Key key;
+
+		if (makeFileKey (dependency.path, key) == false
+			|| memcmp (&key, &dependency.key, sizeof key) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// =============================================================================
+//
+// Adds the file at @path to the dependencies.
+//
+void Module::addDependency (const String& path)
+{
+	Dependency dependency;
+	dependency.path = path;
+
+	if (makeFileKey (path, dependency.key) == false)
+		error ("couldn't read %1: %2", path, strerror (errno));
+
+	dependencies << dependency;
+}
+
+// =============================================================================
+//
+int Module::dependencyIndex (const String& path)
+{
+	for (int i = 0; i < dependencies.size(); ++i)
+	{
+		if (dependencies[i].path == path)
+			return i;
+	}
+
+	addDependency (path);
+	return dependencies.size() - 1;
+}
+
+// =============================================================================
+//
+// Keeps the declarations of @declarations whose source is not in @indices.
+//
+template<typename T>
+static void leaveOutDeclarations (List<T>& declarations, List<int>& sources,
+	const std::set<int>& indices)
+{
+	List<T> keptDeclarations;
+	List<int> keptSources;
+
+	for (int i = 0; i < declarations.size(); ++i)
+	{
+		if (indices.find (sources[i]) == indices.end())
+		{
+			keptDeclarations << declarations[i];
+			keptSources << sources[i];
+		}
+	}
+
+	declarations = keptDeclarations;
+	sources = keptSources;
+}
+
+// =============================================================================
+//
+// The strings that are left are the ones the remaining string constants use,
+// in the same order as before, as that is the order they were declared in.
+//
+void Module::leaveOut (const std::set<int>& indices)
+{
+	if (indices.empty())
+		return;
+
+	leaveOutDeclarations (commands, commandSources, indices);
+	leaveOutDeclarations (events, eventSources, indices);
+	leaveOutDeclarations (variables, variableSources, indices);
+	std::vector<bool> isUsed (strings.size(), false);
+	std::vector<int> stringIndices (strings.size(), -1);
+	StringList keptStrings;
+
+	for (const Variable& var : variables)
+	{
+		if (var.type == TYPE_String && var.writelevel == WRITE_Constexpr)
+			isUsed[var.value] = true;
+	}
+
+	for (int i = 0; i < strings.size(); ++i)
+	{
+		if (isUsed[i])
+		{
+			stringIndices[i] = keptStrings.size();
+			keptStrings << strings[i];
+		}
+	}
+
+	for (Variable& var : variables)
+	{
+		if (var.type == TYPE_String && var.writelevel == WRITE_Constexpr)
+			var.value = stringIndices[var.value];
+	}
+
+	strings = keptStrings;
+}
+
+// =============================================================================
+//
+String Module::moduleFileName (const String& path)
+{
+	int extdot = path.lastIndexOf (".");
+
+	if (extdot == -1 || extdot < path.lastIndexOf ("/"))
+		return path + ".bpm";
+
+	return path.mid (0, extdot) + ".bpm";
+}
@@ -0,0 +1,115 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_MODULE_H
+#define BOTC_MODULE_H
+
+#include <map>
+#include <set>
+#include "main.h"
+#include "commands.h"
+#include "events.h"
+#include "parser.h"
+#include "tokenCache.h"
+
+// =============================================================================
+//
+// A precompiled module: the declarations of a script that declares nothing but
+// commands, events and global variables, as made by botc --precompile. When a
+// script #includes such a script and there is a module with the same name but
+// the .bpm extension next to it, the lexer loads the module instead and the
+// parser declares what is in it without looking at the script at all.
+//
+// A module is only used if it was made from exactly the files that would now
+// be included and in the same circumstances, so that including it gives the
+// same result as including the script would. Otherwise the script is included
+// as usual. Files of the module that have already been included are left out
+// like they would be of the script, along with what was declared in them.
+//
+class Module
+{
+public:
+	// A file that the declarations were read from, the first one being the
+	// script itself.
+	struct Dependency
+	{
+		String				path;
+		TokenCache::Key		key;
+	};
+
+	String						path; // of the module itself
+	bool						hasBuiltinDefinitions;
+	int							zandronumVersion; // -1 if not set by the script
+	List<Dependency>			dependencies;
+
+	// The #defines in effect when the script was included, and after it.
+	std::map<String, int>		initialDefines;
+	std::map<String, int>		defines;
+
+	List<CommandInfo>			commands;
+	List<EventDefinition>		events;
+	List<Variable>				variables; // values of string constants index @strings
+	StringList					strings;
+
+	// The file each declaration was made in, as an index to @dependencies.
+	List<int>					commandSources;
+	List<int>					eventSources;
+	List<int>					variableSources;
+
+	// Reads the module at @path. Returns null if it is not a module made by
+	// this very version of botc.
+	static Module* load (const String& path);
+
+	void write (const String& path) const;
+	void addDependency (const String& path);
+
+	// Returns the index of the dependency at @path, adding it if it isn't
+	// one yet.
+	int dependencyIndex (const String& path);
+
+	// Leaves out the declarations made in the dependencies at @indices, and
+	// the strings that only they used.
+	void leaveOut (const std::set<int>& indices);
+
+	// Are the files the module was made from still the same as when it was?
+	bool isUpToDate() const;
+
+	// Gives the name of the module of the script at @path.
+	static String moduleFileName (const String& path);
+
+private:
+	// Must be changed whenever the layout of module files does.
+	enum
+	{
+		FormatVersion = 2
+	};
+
+	struct Header;
+};
+
+#endif // BOTC_MODULE_H
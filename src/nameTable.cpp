@@ -0,0 +1,130 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "nameTable.h"
+
+// =============================================================================
+//
+static inline char foldCase (char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+// =============================================================================
+//
+static uint32_t hashName (const char* name, int length)
+{
+	uint32_t hash = 2166136261u;
+
+	for (int i = 0; i < length; ++i)
+		hash = (hash ^ (unsigned char) foldCase (name[i])) * 16777619u;
+
+	return hash;
+}
+
+// =============================================================================
+//
+static bool namesMatch (const String& a, const char* b, int length)
+{
+	if (a.length() != length)
+		return false;
+
+	for (int i = 0; i < length; ++i)
+	{
+		if (foldCase (a[i]) != foldCase (b[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// =============================================================================
+//
+// Returns the slot @name is in, or the empty slot it would go to.
+//
+int NameTable::findSlot (const char* name, int length, uint32_t hash) const
+{
+	int mask = m_slots.size() - 1;
+
+	for (int slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		int id = m_slots[slot];
+
+		if (id == -1 || (m_names[id].hash == hash && namesMatch (m_names[id].name, name, length)))
+			return slot;
+	}
+}
+
+// =============================================================================
+//
+int NameTable::find (const char* name, int length) const
+{
+	if (m_slots.empty())
+		return -1;
+
+	return m_slots[findSlot (name, length, hashName (name, length))];
+}
+
+// =============================================================================
+//
+// Returns the id of @name, entering it into the table if it is not there yet.
+//
+int NameTable::intern (const char* name, int length)
+{
+	if ((m_names.size() + 1) * 2 > (int) m_slots.size())
+	{
+		m_slots.assign (max<int> (m_slots.size() * 2, 256), -1);
+		int mask = m_slots.size() - 1;
+
+		for (int id = 0; id < m_names.size(); ++id)
+		{
+			int slot = m_names[id].hash & mask;
+
+			while (m_slots[slot] != -1)
+				slot = (slot + 1) & mask;
+
+			m_slots[slot] = id;
+		}
+	}
+
+	uint32_t hash = hashName (name, length);
+	int slot = findSlot (name, length, hash);
+
+	if (m_slots[slot] == -1)
+	{
+		NameInfo info;
+		info.name = String (name, length);
+		info.hash = hash;
+		info.command = null;
+		info.event = null;
+		m_slots[slot] = m_names.size();
+		m_names << info;
+	}
+
+	return m_slots[slot];
+}
@@ -0,0 +1,85 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_NAME_TABLE_H
+#define BOTC_NAME_TABLE_H
+
+#include <vector>
+#include "main.h"
+
+struct CommandInfo;
+struct EventDefinition;
+
+// =============================================================================
+//
+// Every name that comes up as a symbol in the source or is given to a command
+// or an event is entered into the name table just once. Names are told apart
+// case-insensitively, so a symbol token can be matched with the command or
+// event of its name by its id alone.
+//
+struct NameInfo
+{
+	String				name; // as it was first entered
+	uint32_t			hash;
+	CommandInfo*		command;
+	EventDefinition*	event;
+};
+
+// =============================================================================
+//
+class NameTable
+{
+	public:
+		int			intern (const char* name, int length);
+		int			find (const char* name, int length) const;
+
+		inline int intern (const String& name)
+		{
+			return intern (name.chars(), name.length());
+		}
+
+		inline int find (const String& name) const
+		{
+			return find (name.chars(), name.length());
+		}
+
+		inline NameInfo& info (int id)
+		{
+			return m_names[id];
+		}
+
+	private:
+		// The names, and an open addressing hash table of their ids with a
+		// power of two number of slots, at most half of which are in use.
+		List<NameInfo>		m_names;
+		std::vector<int>	m_slots;
+
+		int			findSlot (const char* name, int length, uint32_t hash) const;
+};
+
+#endif // BOTC_NAME_TABLE_H
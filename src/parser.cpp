@@ -33,7 +33,10 @@
 #include "list.h"
 #include "lexer.h"
 #include "dataBuffer.h"
+#include "emitter.h"
 #include "expression.h"
+#include "module.h"
+#include "compilerContext.h"
 
 #define SCOPE(n) (m_scopeStack[m_scopeCursor - n])
 
@@ -41,12 +44,14 @@ static const StringList g_validZandronumVersions = {"1.2", "1.3", "2.0"};
 
 // ============================================================================
 //
-BotscriptParser::BotscriptParser() :
+BotscriptParser::BotscriptParser (CompilerContext* context) :
 	m_isReadOnly (false),
-	m_mainBuffer (new DataBuffer),
-	m_onenterBuffer (new DataBuffer),
-	m_mainLoopBuffer (new DataBuffer),
-	m_lexer (new Lexer),
+	m_context (context),
+	m_mainBuffer (context->makeBuffer()),
+	m_onenterBuffer (context->makeBuffer()),
+	m_mainLoopBuffer (context->makeBuffer()),
+	m_switchBuffer (null),
+	m_lexer (new Lexer (context)),
 	m_numStates (0),
 	m_numEvents (0),
 	m_currentMode (PARSERMODE_TopLevel),
@@ -56,6 +61,8 @@ BotscriptParser::BotscriptParser() :
 	m_isElseAllowed (false),
 	m_highestGlobalVarIndex (0),
 	m_highestStateVarIndex (0),
+	m_numPredefinedCommands (0),
+	m_numPredefinedEvents (0),
 	m_zandronumVersion (10200), // 1.2
 	m_defaultZandronumVersion (true) {}
 
@@ -63,6 +70,9 @@ BotscriptParser::BotscriptParser() :
 //
 BotscriptParser::~BotscriptParser()
 {
+	for (DataBuffer* buf : List<DataBuffer*> ({m_mainBuffer, m_onenterBuffer, m_mainLoopBuffer}))
+		m_context->recycleBuffer (buf);
+
 	delete m_lexer;
 }
 
@@ -91,6 +101,8 @@ void BotscriptParser::checkNotToplevel()
 void BotscriptParser::parseBotscript (String fileName)
 {
 	// Lex and preprocess the file
+	m_numPredefinedCommands = m_context->commands().size();
+	m_numPredefinedEvents = m_context->events().size();
 	m_lexer->processFile (fileName);
 	pushScope();
 
@@ -103,7 +115,7 @@ void BotscriptParser::parseBotscript (String fileName)
 		if (tokenIs (TK_Else) == false)
 			m_isElseAllowed = false;
 
-		switch (m_lexer->token()->type)
+		switch (m_lexer->token().type)
 		{
 			case TK_State:
 				parseStateBlock();
@@ -126,6 +138,10 @@ void BotscriptParser::parseBotscript (String fileName)
 				parseVar();
 				break;
 
+			case TK_Module:
+				parseModule();
+				break;
+
 			case TK_If:
 				parseIf();
 				break;
@@ -188,7 +204,8 @@ void BotscriptParser::parseBotscript (String fileName)
 			default:
 			{
 				// Check if it's a command
-				CommandInfo* comm = findCommandByName (getTokenString());
+				CommandInfo* comm = (m_lexer->tokenType() == TK_Symbol)
+					? m_context->names().info (m_lexer->token().name).command : null;
 
 				if (comm)
 				{
@@ -201,7 +218,7 @@ void BotscriptParser::parseBotscript (String fileName)
 				m_lexer->skip (-1);
 				DataBuffer* b = parseStatement();
 
-				if (b == false)
+				if (b == null)
 				{
 					m_lexer->next();
 					error ("unknown token `%1`", getTokenString());
@@ -266,10 +283,8 @@ void BotscriptParser::parseStateBlock()
 	if (m_currentState.isEmpty() == false)
 		writeMemberBuffers();
 
-	currentBuffer()->writeDWord (DH_StateName);
-	currentBuffer()->writeString (statename);
-	currentBuffer()->writeDWord (DH_StateIndex);
-	currentBuffer()->writeDWord (m_numStates);
+	emitter().emit<DH_StateName> (statename);
+	emitter().emit<DH_StateIndex> (m_numStates);
 
 	m_numStates++;
 	m_currentState = statename;
@@ -283,15 +298,14 @@ void BotscriptParser::parseEventBlock()
 	checkToplevel();
 	m_lexer->mustGetNext (TK_String);
 
-	EventDefinition* e = findEventByName (getTokenString());
+	EventDefinition* e = m_context->findEventByName (getTokenString());
 
 	if (e == null)
 		error ("bad event, got `%1`\n", getTokenString());
 
 	m_lexer->mustGetNext (TK_BraceStart);
 	m_currentMode = PARSERMODE_Event;
-	currentBuffer()->writeDWord (DH_Event);
-	currentBuffer()->writeDWord (e->number);
+	emitter().emit<DH_Event> (e->number);
 	m_numEvents++;
 }
 
@@ -303,7 +317,7 @@ void BotscriptParser::parseMainloop()
 	m_lexer->mustGetNext (TK_BraceStart);
 
 	m_currentMode = PARSERMODE_MainLoop;
-	m_mainLoopBuffer->writeDWord (DH_MainLoop);
+	Emitter (m_mainLoopBuffer).emit<DH_MainLoop>();
 }
 
 // ============================================================================
@@ -315,15 +329,15 @@ void BotscriptParser::parseOnEnterExit()
 	m_lexer->mustGetNext (TK_BraceStart);
 
 	m_currentMode = onenter ? PARSERMODE_Onenter : PARSERMODE_Onexit;
-	currentBuffer()->writeDWord (onenter ? DH_OnEnter : DH_OnExit);
+	emitter().emit (onenter ? DH_OnEnter : DH_OnExit);
 }
 
 // ============================================================================
 //
 void BotscriptParser::parseVar()
 {
-	Variable* var = new Variable;
-	var->origin = m_lexer->describeCurrentPosition();
+	Variable* var = m_context->arena().make<Variable>();
+	var->origin = m_lexer->token().location;
 	var->isarray = false;
 	const bool isconst = m_lexer->next (TK_Const);
 	m_lexer->mustGetAnyOf ({TK_Int,TK_Str,TK_Void});
@@ -334,7 +348,8 @@ void BotscriptParser::parseVar()
 
 	m_lexer->mustGetNext (TK_DollarSign);
 	m_lexer->mustGetNext (TK_Symbol);
-	String name = getTokenString();
+	Lexer::TokenInfo nametoken = m_lexer->token();
+	String name = nametoken.text;
 
 	if (m_lexer->next (TK_BracketStart))
 	{
@@ -345,14 +360,8 @@ void BotscriptParser::parseVar()
 			error ("arrays cannot be const");
 	}
 
-	for (Variable* var : SCOPE(0).globalVariables + SCOPE(0).localVariables)
-	{
-		if (var->name == name)
-			error ("Variable $%1 is already declared on this scope; declared at %2",
-				var->name, var->origin);
-	}
-
 	var->name = name;
+	var->nameid = nametoken.name;
 	var->statename = "";
 	var->type = vartype;
 
@@ -379,6 +388,34 @@ void BotscriptParser::parseVar()
 		}
 	}
 
+	declareVariable (var);
+
+	if (isReadOnly() && m_scopeCursor == 0)
+		m_variableSources << fileNameAt (var->origin);
+
+	m_lexer->mustGetNext (TK_Semicolon);
+	print ("Declared %3 variable #%1 $%2\n", var->index, var->name, isInGlobalState() ? "global" : "state-local");
+}
+
+// ============================================================================
+//
+// Adds @var to the current scope. Its name, type and value must be set.
+//
+void BotscriptParser::declareVariable (Variable* var)
+{
+	if (var->nameid >= m_variablesByName.size())
+		m_variablesByName.resize (var->nameid + 1);
+
+	// The variables of this scope are at the front of the chain.
+	for (Variable* other = m_variablesByName[var->nameid];
+		other != null && other->scopelevel == m_scopeCursor;
+		other = other->shadowed)
+	{
+		if (other->name == var->name)
+			error ("Variable $%1 is already declared on this scope; declared at %2",
+				other->name, m_lexer->describeLocation (other->origin));
+	}
+
 	// Assign an index for the variable if it is not constexpr. Constexpr
 	// variables can simply be substituted out for their value when used
 	// so they need no index.
@@ -392,16 +429,96 @@ void BotscriptParser::parseVar()
 		{
 			error ("too many %1 variables", isglobal ? "global" : "state-local");
 		}
+
+		suggestHighestVarIndex (isglobal, var->index);
 	}
 
-	if (isInGlobalState())
-		SCOPE(0).globalVariables << var;
-	else
-		SCOPE(0).localVariables << var;
+	var->scopelevel = m_scopeCursor;
+	var->shadowed = m_variablesByName[var->nameid];
+	m_variablesByName[var->nameid] = var;
+	SCOPE(0).variables << var;
+}
 
-	suggestHighestVarIndex (isInGlobalState(), var->index);
-	m_lexer->mustGetNext (TK_Semicolon);
-	print ("Declared %3 variable #%1 $%2\n", var->index, var->name, isInGlobalState() ? "global" : "state-local");
+// ============================================================================
+//
+// Returns the name of the file @location is in.
+//
+String BotscriptParser::fileNameAt (SourceLocation location)
+{
+	String file;
+	int line, column;
+	m_lexer->decodeLocation (location, &file, &line, &column);
+	return file;
+}
+
+// ============================================================================
+//
+// Declares the contents of a precompiled module the way parsing the script it
+// was made from would have, in the same order. Like that script, it can be
+// included within a state, making its variables state-local.
+//
+void BotscriptParser::parseModule()
+{
+	const Module& module = *m_lexer->modules()[m_lexer->token().number];
+	SourceLocation location = m_lexer->token().location;
+	String origin = m_lexer->describeLocation (location);
+
+	if (module.zandronumVersion != -1 && m_currentMode != PARSERMODE_TopLevel)
+		error ("%1 has a using-statement and may only be included at top level", module.path);
+
+	for (int i = 0; i < module.commands.size(); ++i)
+	{
+		CommandInfo* copy = m_context->arena().make<CommandInfo> (module.commands[i]);
+		copy->origin = origin;
+		m_context->addCommandDefinition (copy);
+
+		if (isReadOnly())
+			m_commandSources << module.dependencies[module.commandSources[i]].path;
+	}
+
+	for (int i = 0; i < module.events.size(); ++i)
+	{
+		m_context->addEvent (m_context->arena().make<EventDefinition> (module.events[i]));
+
+		if (isReadOnly())
+			m_eventSources << module.dependencies[module.eventSources[i]].path;
+	}
+
+	List<int> stringIndices;
+
+	// When nothing is emitted, the module's strings still count towards the
+	// limit of the string table, but need not go into it.
+	for (const String& text : module.strings)
+	{
+		if (m_context->isDiscarding())
+		{
+			m_context->stringTable().check (text);
+			stringIndices << 0;
+		}
+		else
+			stringIndices << m_context->stringTable().getIndex (text);
+	}
+
+	for (int i = 0; i < module.variables.size(); ++i)
+	{
+		Variable* var = m_context->arena().make<Variable> (module.variables[i]);
+		var->origin = location;
+		var->nameid = m_context->names().intern (var->name);
+
+		if (var->type == TYPE_String && var->writelevel == WRITE_Constexpr)
+			var->value = stringIndices[var->value];
+
+		declareVariable (var);
+
+		if (isReadOnly() && m_scopeCursor == 0)
+			m_variableSources << module.dependencies[module.variableSources[i]].path;
+	}
+
+	if (module.zandronumVersion != -1)
+	{
+		m_zandronumVersion = module.zandronumVersion;
+		m_defaultZandronumVersion = false;
+	}
 }
 
 // ============================================================================
@@ -423,12 +540,11 @@ void BotscriptParser::parseIf()
 
 	// Add a mark - to here temporarily - and add a reference to it.
 	// Upon a closing brace, the mark will be adjusted.
-	ByteMark* mark = currentBuffer()->addMark ("");
+	ByteMark mark = currentBuffer()->addMark();
 
 	// Use DH_IfNotGoto - if the expression is not true, we goto the mark
 	// we just defined - and this mark will be at the end of the scope block.
-	currentBuffer()->writeDWord (DH_IfNotGoto);
-	currentBuffer()->addReference (mark);
+	emitter().emit<DH_IfNotGoto> (mark);
 
 	// Store it
 	SCOPE (0).mark1 = mark;
@@ -448,11 +564,10 @@ void BotscriptParser::parseElse()
 
 	// write down to jump to the end of the else statement
 	// Otherwise we have fall-throughs
-	SCOPE (0).mark2 = currentBuffer()->addMark ("");
+	SCOPE (0).mark2 = currentBuffer()->addMark();
 
 	// Instruction to jump to the end after if block is complete
-	currentBuffer()->writeDWord (DH_Goto);
-	currentBuffer()->addReference (SCOPE (0).mark2);
+	emitter().emit<DH_Goto> (SCOPE (0).mark2);
 
 	// Move the ifnot mark here and set type to else
 	currentBuffer()->adjustMark (SCOPE (0).mark1);
@@ -470,8 +585,8 @@ void BotscriptParser::parseWhileBlock()
 	// end. The condition is checked at the very start of the loop, if it fails,
 	// we use goto to skip to the end of the loop. At the end, we loop back to
 	// the beginning with a go-to statement.
-	ByteMark* mark1 = currentBuffer()->addMark (""); // start
-	ByteMark* mark2 = currentBuffer()->addMark (""); // end
+	ByteMark mark1 = currentBuffer()->addMark(); // start
+	ByteMark mark2 = currentBuffer()->addMark(); // end
 
 	// Condition
 	m_lexer->mustGetNext (TK_ParenStart);
@@ -483,8 +598,7 @@ void BotscriptParser::parseWhileBlock()
 	currentBuffer()->mergeAndDestroy (expr);
 
 	// Instruction to go to the end if it fails
-	currentBuffer()->writeDWord (DH_IfNotGoto);
-	currentBuffer()->addReference (mark2);
+	emitter().emit<DH_IfNotGoto> (mark2);
 
 	// Store the needed stuff
 	SCOPE (0).mark1 = mark1;
@@ -529,13 +643,12 @@ void BotscriptParser::parseForBlock()
 	currentBuffer()->mergeAndDestroy (init);
 
 	// Init two marks
-	ByteMark* mark1 = currentBuffer()->addMark ("");
-	ByteMark* mark2 = currentBuffer()->addMark ("");
+	ByteMark mark1 = currentBuffer()->addMark();
+	ByteMark mark2 = currentBuffer()->addMark();
 
 	// Add the condition
 	currentBuffer()->mergeAndDestroy (cond);
-	currentBuffer()->writeDWord (DH_IfNotGoto);
-	currentBuffer()->addReference (mark2);
+	emitter().emit<DH_IfNotGoto> (mark2);
 
 	// Store the marks and incrementor
 	SCOPE (0).mark1 = mark1;
@@ -551,7 +664,7 @@ void BotscriptParser::parseDoBlock()
 	checkNotToplevel();
 	pushScope();
 	m_lexer->mustGetNext (TK_BraceStart);
-	SCOPE (0).mark1 = currentBuffer()->addMark ("");
+	SCOPE (0).mark1 = currentBuffer()->addMark();
 	SCOPE (0).type = SCOPE_Do;
 }
 
@@ -579,7 +692,7 @@ void BotscriptParser::parseSwitchBlock()
 	m_lexer->mustGetNext (TK_ParenEnd);
 	m_lexer->mustGetNext (TK_BraceStart);
 	SCOPE (0).type = SCOPE_Switch;
-	SCOPE (0).mark1 = currentBuffer()->addMark (""); // end mark
+	SCOPE (0).mark1 = currentBuffer()->addMark(); // end mark
 	SCOPE (0).buffer1 = null; // default header
 }
 
@@ -594,7 +707,7 @@ void BotscriptParser::parseSwitchCase()
 	// Get a literal value for the case block. Zandronum does not support
 	// expressions here.
 	m_lexer->mustGetNext (TK_Number);
-	int num = m_lexer->token()->text.toLong();
+	int num = m_lexer->token().number;
 	m_lexer->mustGetNext (TK_Colon);
 
 	for (const CaseInfo& info : SCOPE(0).cases)
@@ -605,16 +718,16 @@ void BotscriptParser::parseSwitchCase()
 	// the case tree. The closing event will write the actual
 	// blocks and move the marks appropriately.
 	//
-	// AddSwitchCase will add the reference to the mark
-	// for the case block that this heralds, and takes care
-	// of buffering setup and stuff like that.
+	// The case-go-to jumps to a mark for the case block that
+	// this heralds. AddSwitchCase takes care of buffering setup
+	// and stuff like that.
 	//
 	// We null the switch buffer for the case-go-to statement as
 	// we want it all under the switch, not into the case-buffers.
 	m_switchBuffer = null;
-	currentBuffer()->writeDWord (DH_CaseGoto);
-	currentBuffer()->writeDWord (num);
-	addSwitchCase (null);
+	ByteMark casemark = currentBuffer()->addMark();
+	emitter().emit<DH_CaseGoto> (num, casemark);
+	addSwitchCase (casemark);
 	SCOPE (0).casecursor->number = num;
 }
 
@@ -637,11 +750,12 @@ void BotscriptParser::parseSwitchDefault()
 	// and is only popped when case succeeds, we have
 	// to pop it with DH_Drop manually if we end up in
 	// a default.
-	DataBuffer* buf = new DataBuffer;
+	DataBuffer* buf = m_context->makeBuffer();
+	ByteMark casemark = currentBuffer()->addMark();
 	SCOPE (0).buffer1 = buf;
-	buf->writeDWord (DH_Drop);
-	buf->writeDWord (DH_Goto);
-	addSwitchCase (buf);
+	Emitter (buf).emit<DH_Drop>();
+	Emitter (buf).emit<DH_Goto> (casemark);
+	addSwitchCase (casemark);
 }
 
 // ============================================================================
@@ -651,8 +765,6 @@ void BotscriptParser::parseBreak()
 	if (m_scopeCursor == 0)
 		error ("unexpected `break`");
 
-	currentBuffer()->writeDWord (DH_Goto);
-
 	// switch and if use mark1 for the closing point,
 	// for and while use mark2.
 	switch (SCOPE (0).type)
@@ -660,13 +772,13 @@ void BotscriptParser::parseBreak()
 		case SCOPE_If:
 		case SCOPE_Switch:
 		{
-			currentBuffer()->addReference (SCOPE (0).mark1);
+			emitter().emit<DH_Goto> (SCOPE (0).mark1);
 		} break;
 
 		case SCOPE_For:
 		case SCOPE_While:
 		{
-			currentBuffer()->addReference (SCOPE (0).mark2);
+			emitter().emit<DH_Goto> (SCOPE (0).mark2);
 		} break;
 
 		default:
@@ -696,8 +808,7 @@ void BotscriptParser::parseContinue()
 			case SCOPE_While:
 			case SCOPE_Do:
 			{
-				currentBuffer()->writeDWord (DH_Goto);
-				currentBuffer()->addReference (m_scopeStack[curs].mark1);
+				emitter().emit<DH_Goto> (m_scopeStack[curs].mark1);
 				found = true;
 			} break;
 
@@ -745,8 +856,7 @@ void BotscriptParser::parseBlockEnd()
 			}
 			case SCOPE_While:
 			{	// write down the instruction to go back to the start of the loop
-				currentBuffer()->writeDWord (DH_Goto);
-				currentBuffer()->addReference (SCOPE (0).mark1);
+				emitter().emit<DH_Goto> (SCOPE (0).mark1);
 
 				// Move the closing mark here since we're at the end of the while loop
 				currentBuffer()->adjustMark (SCOPE (0).mark2);
@@ -763,8 +873,7 @@ void BotscriptParser::parseBlockEnd()
 
 				// If the condition runs true, go back to the start.
 				currentBuffer()->mergeAndDestroy (expr);
-				currentBuffer()->writeDWord (DH_IfGoto);
-				currentBuffer()->addReference (SCOPE (0).mark1);
+				emitter().emit<DH_IfGoto> (SCOPE (0).mark1);
 				break;
 			}
 
@@ -784,9 +893,8 @@ void BotscriptParser::parseBlockEnd()
 					currentBuffer()->mergeAndDestroy (SCOPE (0).buffer1);
 				else
 				{
-					currentBuffer()->writeDWord (DH_Drop);
-					currentBuffer()->writeDWord (DH_Goto);
-					currentBuffer()->addReference (SCOPE (0).mark1);
+					emitter().emit<DH_Drop>();
+					emitter().emit<DH_Goto> (SCOPE (0).mark1);
 				}
 
 				// Go through all of the buffers we
@@ -807,7 +915,7 @@ void BotscriptParser::parseBlockEnd()
 		}
 
 		// Descend down the stack
-		m_scopeCursor--;
+		popScope();
 		return;
 	}
 
@@ -822,7 +930,7 @@ void BotscriptParser::parseBlockEnd()
 	// Data header must be written before mode is changed because
 	// onenter and mainloop go into special buffers, and we want
 	// the closing data headers into said buffers too.
-	currentBuffer()->writeDWord (dataheader);
+	emitter().emit (DataHeader (dataheader));
 	m_currentMode = PARSERMODE_TopLevel;
 	m_lexer->next (TK_Semicolon);
 }
@@ -831,39 +939,44 @@ void BotscriptParser::parseBlockEnd()
 //
 void BotscriptParser::parseEventdef()
 {
-	EventDefinition* e = new EventDefinition;
+	EventDefinition* e = m_context->arena().make<EventDefinition>();
+	SourceLocation location = m_lexer->token().location;
 
 	m_lexer->mustGetNext (TK_Number);
-	e->number = getTokenString().toLong();
+	e->number = m_lexer->token().number;
 	m_lexer->mustGetNext (TK_Colon);
 	m_lexer->mustGetNext (TK_Symbol);
-	e->name = m_lexer->token()->text;
+	e->name = m_lexer->token().text;
 	m_lexer->mustGetNext (TK_ParenStart);
 	m_lexer->mustGetNext (TK_ParenEnd);
 	m_lexer->mustGetNext (TK_Semicolon);
-	addEvent (e);
+	m_context->addEvent (e);
+
+	if (isReadOnly())
+		m_eventSources << fileNameAt (location);
 }
 
 // =============================================================================
 //
 void BotscriptParser::parseFuncdef()
 {
-	CommandInfo* comm = new CommandInfo;
-	comm->origin = m_lexer->describeCurrentPosition();
+	CommandInfo* comm = m_context->arena().make<CommandInfo>();
+	SourceLocation location = m_lexer->token().location;
+	comm->origin = m_lexer->describeLocation (location);
 
 	// Return value
 	m_lexer->mustGetAnyOf ({TK_Int,TK_Void,TK_Bool,TK_Str});
-	comm->returnvalue = getTypeByName (m_lexer->token()->text); // TODO
+	comm->returnvalue = getTypeByName (m_lexer->token().text); // TODO
 	ASSERT_NE (comm->returnvalue, -1);
 
 	// Number
 	m_lexer->mustGetNext (TK_Number);
-	comm->number = m_lexer->token()->text.toLong();
+	comm->number = m_lexer->token().number;
 	m_lexer->mustGetNext (TK_Colon);
 
 	// Name
 	m_lexer->mustGetNext (TK_Symbol);
-	comm->name = m_lexer->token()->text;
+	comm->name = m_lexer->token().text;
 
 	// Arguments
 	m_lexer->mustGetNext (TK_ParenStart);
@@ -876,13 +989,14 @@ void BotscriptParser::parseFuncdef()
 
 		CommandArgument arg;
 		m_lexer->mustGetAnyOf ({TK_Int,TK_Bool,TK_Str});
-		DataType type = getTypeByName (m_lexer->token()->text); // TODO
+		DataType type = getTypeByName (m_lexer->token().text); // TODO
 		ASSERT_NE (type, -1)
 		ASSERT_NE (type, TYPE_Void)
 		arg.type = type;
 
 		m_lexer->mustGetNext (TK_Symbol);
-		arg.name = m_lexer->token()->text;
+		arg.name = m_lexer->token().text;
+		arg.defvalue = 0;
 
 		// If this is an optional parameter, we need the default value.
 		if (comm->minargs < comm->args.size() || m_lexer->peekNextType (TK_Assign))
@@ -904,7 +1018,7 @@ void BotscriptParser::parseFuncdef()
 					break;
 			}
 
-			arg.defvalue = m_lexer->token()->text.toLong();
+			arg.defvalue = m_lexer->token().number;
 		}
 		else
 			comm->minargs++;
@@ -914,7 +1028,10 @@ void BotscriptParser::parseFuncdef()
 
 	m_lexer->mustGetNext (TK_ParenEnd);
 	m_lexer->mustGetNext (TK_Semicolon);
-	addCommandDefinition (comm);
+	m_context->addCommandDefinition (comm);
+
+	if (isReadOnly())
+		m_commandSources << fileNameAt (location);
 }
 
 // ============================================================================
@@ -948,7 +1065,7 @@ void BotscriptParser::parseUsing()
 //
 DataBuffer* BotscriptParser::parseCommand (CommandInfo* comm)
 {
-	DataBuffer* r = new DataBuffer (64);
+	DataBuffer* r = m_context->makeBuffer();
 
 	if (m_currentMode == PARSERMODE_TopLevel && comm->returnvalue == TYPE_Void)
 		error ("command call at top level");
@@ -1002,14 +1119,11 @@ DataBuffer* BotscriptParser::parseCommand (CommandInfo* comm)
 	// If the script skipped any optional arguments, fill in defaults.
 	while (curarg < comm->args.size())
 	{
-		r->writeDWord (DH_PushNumber);
-		r->writeDWord (comm->args[curarg].defvalue);
+		Emitter (r).emit<DH_PushNumber> (comm->args[curarg].defvalue);
 		curarg++;
 	}
 
-	r->writeDWord (DH_Command);
-	r->writeDWord (comm->number);
-	r->writeDWord (comm->args.size());
+	Emitter (r).emit<DH_Command> (comm->number, comm->args.size());
 
 	return r;
 }
@@ -1121,7 +1235,6 @@ DataHeader BotscriptParser::getAssigmentDataHeader (AssignmentOperator op, Varia
 //
 DataBuffer* BotscriptParser::parseAssignment (Variable* var)
 {
-	DataBuffer* retbuf = new DataBuffer;
 	DataBuffer* arrayindex = null;
 
 	if (var->writelevel != WRITE_Mutable)
@@ -1131,8 +1244,7 @@ DataBuffer* BotscriptParser::parseAssignment (Variable* var)
 	{
 		m_lexer->mustGetNext (TK_BracketStart);
 		Expression expr (this, m_lexer, TYPE_Int);
-		expr.getResult()->convertToBuffer();
-		arrayindex = expr.getResult()->buffer()->clone();
+		arrayindex = expr.getResult()->takeBuffer (m_context);
 		m_lexer->mustGetNext (TK_BracketEnd);
 	}
 
@@ -1142,16 +1254,24 @@ DataBuffer* BotscriptParser::parseAssignment (Variable* var)
 	if (m_currentMode == PARSERMODE_TopLevel)
 		error ("can't alter variables at top level");
 
-	if (var->isarray)
-		retbuf->mergeAndDestroy (arrayindex);
+	// The assignment is built on the buffer of the array index, if there is
+	// one, or else that of the right operand.
+	DataBuffer* retbuf = arrayindex;
 
 	// Parse the right operand
 	if (oper != ASSIGNOP_Increase && oper != ASSIGNOP_Decrease)
 	{
 		DataBuffer* expr = parseExpression (var->type);
-		retbuf->mergeAndDestroy (expr);
+
+		if (retbuf == null)
+			retbuf = expr;
+		else
+			retbuf->mergeAndDestroy (expr);
 	}
 
+	if (retbuf == null)
+		retbuf = m_context->makeBuffer();
+
 #if 0
 	// <<= and >>= do not have data headers. Solution: expand them.
 	// a <<= b -> a = a << b
@@ -1165,8 +1285,7 @@ DataBuffer* BotscriptParser::parseAssignment (Variable* var)
 #endif
 
 	DataHeader dh = getAssigmentDataHeader (oper, var);
-	retbuf->writeDWord (dh);
-	retbuf->writeDWord (var->index);
+	Emitter (retbuf).emit (dh, var->index);
 	return retbuf;
 }
 
@@ -1187,8 +1306,8 @@ void BotscriptParser::pushScope (EReset reset)
 	{
 		ScopeInfo* info = &SCOPE (0);
 		info->type = SCOPE_Unknown;
-		info->mark1 = null;
-		info->mark2 = null;
+		info->mark1 = ByteMark();
+		info->mark2 = ByteMark();
 		info->buffer1 = null;
 		info->cases.clear();
 		info->casecursor = info->cases.begin() - 1;
@@ -1198,11 +1317,25 @@ void BotscriptParser::pushScope (EReset reset)
 	SCOPE(0).globalVarIndexBase = (m_scopeCursor == 0) ? 0 : SCOPE(1).globalVarIndexBase;
 	SCOPE(0).localVarIndexBase = (m_scopeCursor == 0) ? 0 : SCOPE(1).localVarIndexBase;
 
-	for (Variable* var : SCOPE(0).globalVariables + SCOPE(0).localVariables)
-		delete var;
+	// Variables left over from the last time this scope was used were already
+	// taken out of sight by popScope(). They are freed with the arena.
+	SCOPE(0).variables.clear();
+}
 
-	SCOPE(0).localVariables.clear();
-	SCOPE(0).globalVariables.clear();
+// ============================================================================
+//
+// Leaves the current scope. Its variables are unbound from their names in the
+// reverse order of their declaration, which brings the variables they shadowed
+// back into sight.
+//
+void BotscriptParser::popScope()
+{
+	List<Variable*>& variables = SCOPE(0).variables;
+
+	for (auto it = variables.rbegin(); it != variables.rend(); ++it)
+		m_variablesByName[(*it)->nameid] = (*it)->shadowed;
+
+	m_scopeCursor--;
 }
 
 // ============================================================================
@@ -1214,11 +1347,10 @@ DataBuffer* BotscriptParser::parseExpression (DataType reqtype, bool fromhere)
 		m_lexer->skip (-1);
 
 	Expression expr (this, m_lexer, reqtype);
-	expr.getResult()->convertToBuffer();
 
-	// The buffer will be destroyed once the function ends so we need to
-	// clone it now.
-	return expr.getResult()->buffer()->clone();
+	// The expression is destroyed once the function ends so we need to take
+	// the buffer out of it now.
+	return expr.getResult()->takeBuffer (m_context);
 }
 
 // ============================================================================
@@ -1229,10 +1361,11 @@ DataBuffer* BotscriptParser::parseStatement()
 	if (m_lexer->next (TK_DollarSign))
 	{
 		m_lexer->mustGetNext (TK_Symbol);
-		Variable* var = findVariable (getTokenString());
+		Lexer::TokenInfo tok = m_lexer->token();
+		Variable* var = findVariable (tok.name, tok.text);
 
 		if (var == null)
-			error ("unknown variable $%1", var->name);
+			error ("unknown variable $%1", getTokenString());
 
 		return parseAssignment (var);
 	}
@@ -1242,25 +1375,18 @@ DataBuffer* BotscriptParser::parseStatement()
 
 // ============================================================================
 //
-void BotscriptParser::addSwitchCase (DataBuffer* casebuffer)
+void BotscriptParser::addSwitchCase (ByteMark casemark)
 {
 	ScopeInfo* info = &SCOPE (0);
 	CaseInfo casedata;
 
-	// Init a mark for the case buffer
-	ByteMark* casemark = currentBuffer()->addMark ("");
+	// "case" and "default" both have referred to the mark
+	// of the case block already.
 	casedata.mark = casemark;
 
-	// Add a reference to the mark. "case" and "default" both
-	// add the necessary bytecode before the reference.
-	if (casebuffer != null)
-		casebuffer->addReference (casemark);
-	else
-		currentBuffer()->addReference (casemark);
-
 	// Init a buffer for the case block and tell the object
 	// writer to record all written data to it.
-	casedata.data = m_switchBuffer = new DataBuffer;
+	casedata.data = m_switchBuffer = m_context->makeBuffer();
 	SCOPE(0).cases << casedata;
 	info->casecursor++;
 }
@@ -1276,15 +1402,17 @@ bool BotscriptParser::tokenIs (ETokenType a)
 //
 String BotscriptParser::getTokenString()
 {
-	return m_lexer->token()->text;
+	return m_lexer->token().text;
 }
 
 // ============================================================================
 //
 String BotscriptParser::describePosition() const
 {
-	Lexer::TokenInfo* tok = m_lexer->token();
-	return tok->file + ":" + String (tok->line) + ":" + String (tok->column);
+	String file;
+	int line, column;
+	m_lexer->decodeLocation (m_lexer->token().location, &file, &line, &column);
+	return file + ":" + String (line) + ":" + String (column);
 }
 
 // ============================================================================
@@ -1303,6 +1431,13 @@ DataBuffer* BotscriptParser::currentBuffer()
 	return m_mainBuffer;
 }
 
+// ============================================================================
+//
+Emitter BotscriptParser::emitter()
+{
+	return Emitter (currentBuffer());
+}
+
 // ============================================================================
 //
 void BotscriptParser::writeMemberBuffers()
@@ -1310,8 +1445,8 @@ void BotscriptParser::writeMemberBuffers()
 	// If there was no mainloop defined, write a dummy one now.
 	if (m_gotMainLoop == false)
 	{
-		m_mainLoopBuffer->writeDWord (DH_MainLoop);
-		m_mainLoopBuffer->writeDWord (DH_EndMainLoop);
+		Emitter (m_mainLoopBuffer).emit<DH_MainLoop>();
+		Emitter (m_mainLoopBuffer).emit<DH_EndMainLoop>();
 	}
 
 	// Write the onenter and mainloop buffers, in that order in particular.
@@ -1320,7 +1455,7 @@ void BotscriptParser::writeMemberBuffers()
 		currentBuffer()->mergeAndDestroy (*bufp);
 
 		// Clear the buffer afterwards for potential next state
-		*bufp = new DataBuffer;
+		*bufp = m_context->makeBuffer();
 	}
 
 	// Next state definitely has no mainloop yet
@@ -1333,18 +1468,17 @@ void BotscriptParser::writeMemberBuffers()
 //
 void BotscriptParser::writeStringTable()
 {
-	int stringcount = countStringsInTable();
+	int stringcount = m_context->stringTable().count();
 
 	if (stringcount == 0)
 		return;
 
 	// Write header
-	m_mainBuffer->writeDWord (DH_StringList);
-	m_mainBuffer->writeDWord (stringcount);
+	Emitter (m_mainBuffer).emit<DH_StringList> (stringcount);
 
 	// Write all strings
 	for (int i = 0; i < stringcount; i++)
-		m_mainBuffer->writeString (getStringTable()[i]);
+		m_mainBuffer->writeString (m_context->stringTable().strings()[i]);
 }
 
 // ============================================================================
@@ -1358,33 +1492,93 @@ void BotscriptParser::writeToFile (String outfile)
 	if (fp == null)
 		error ("couldn't open %1 for writing: %2", outfile, strerror (errno));
 
-	// First, resolve references
-	for (MarkReference* ref : m_mainBuffer->references())
-		for (int i = 0; i < 4; ++i)
-			m_mainBuffer->buffer()[ref->pos + i] = (ref->target->pos >> (8 * i)) & 0xFF;
+	// First, lay the bytecode out in one piece and resolve references
+	m_mainBuffer->flatten();
 
 	// Then, dump the main buffer to the file
-	fwrite (m_mainBuffer->buffer(), 1, m_mainBuffer->writtenSize(), fp);
+	fwrite (m_mainBuffer->data(), 1, m_mainBuffer->writtenSize(), fp);
 	print ("-- %1 byte%s1 written to %2\n", m_mainBuffer->writtenSize(), outfile);
 	fclose (fp);
 }
 
 // ============================================================================
 //
-// Attempt to find the variable by the given name. Looks from current scope
-// downwards.
+// Writes the declarations of the parsed script into a precompiled module. The
+// script must not have anything else in it.
 //
-Variable* BotscriptParser::findVariable (const String& name)
+void BotscriptParser::writeModule (String outfile)
 {
-	for (int i = m_scopeCursor; i >= 0; --i)
+	if (m_numStates > 0 || m_numEvents > 0 || m_mainBuffer->writtenSize() > 0)
+		error ("only scripts with nothing but declarations in them can be precompiled");
+
+	Module module;
+	module.path = outfile;
+	module.hasBuiltinDefinitions = m_lexer->hasBuiltinDefinitions();
+	module.zandronumVersion = m_defaultZandronumVersion ? -1 : m_zandronumVersion;
+	module.initialDefines = m_lexer->initialDefines();
+	module.defines = m_lexer->defines();
+	module.strings = m_context->stringTable().strings();
+
+	for (const Lexer::SourceFile& file : m_lexer->files())
+		module.addDependency (file.name);
+
+	// The files of the included modules that were included before are
+	// dependencies already.
+	for (const Module* included : m_lexer->modules())
 	{
-		for (Variable* var : m_scopeStack[i].globalVariables + m_scopeStack[i].localVariables)
+		for (const Module::Dependency& dependency : included->dependencies)
 		{
-			if (var->name == name)
-				return var;
+			bool isListed = false;
+
+			for (const Module::Dependency& other : module.dependencies)
+				isListed = isListed || other.path == dependency.path;
+
+			if (isListed == false)
+				module.dependencies << dependency;
 		}
 	}
 
+	for (int i = m_numPredefinedCommands; i < m_context->commands().size(); ++i)
+	{
+		module.commands << *m_context->commands()[i];
+		module.commandSources << module.dependencyIndex (m_commandSources[i - m_numPredefinedCommands]);
+	}
+
+	for (int i = m_numPredefinedEvents; i < m_context->events().size(); ++i)
+	{
+		module.events << *m_context->events()[i];
+		module.eventSources << module.dependencyIndex (m_eventSources[i - m_numPredefinedEvents]);
+	}
+
+	for (int i = 0; i < SCOPE(0).variables.size(); ++i)
+	{
+		module.variables << *SCOPE(0).variables[i];
+		module.variableSources << module.dependencyIndex (m_variableSources[i]);
+	}
+
+	module.write (outfile);
+	print ("-- %1 declaration%s1 written to %2\n",
+		module.commands.size() + module.events.size() + module.variables.size(), outfile);
+}
+
+// ============================================================================
+//
+// Attempt to find the variable by the given name. @nameid is the id of the
+// name in the name table. Since those are told apart case-insensitively,
+// the chain of the id is followed until the exact name is found. Inner scopes
+// come first in the chain.
+//
+Variable* BotscriptParser::findVariable (int nameid, StringView name)
+{
+	if (nameid < 0 || nameid >= m_variablesByName.size())
+		return null;
+
+	for (Variable* var = m_variablesByName[nameid]; var != null; var = var->shadowed)
+	{
+		if (name == var->name)
+			return var;
+	}
+
 	return null;
 }
 
@@ -35,7 +35,9 @@
 #include "lexerScanner.h"
 #include "tokens.h"
 
+class CompilerContext;
 class DataBuffer;
+class Emitter;
 class Lexer;
 class Variable;
 
@@ -105,8 +107,11 @@ struct Variable
 	int				index;
 	Writability		writelevel;
 	int				value;
-	String			origin;
+	SourceLocation	origin;
 	bool			isarray;
+	int				nameid; // see nameTable.h
+	int				scopelevel;
+	Variable*		shadowed; // variable of the same name id declared before
 
 	inline bool IsGlobal() const
 	{
@@ -118,7 +123,7 @@ struct Variable
 //
 struct CaseInfo
 {
-	ByteMark*		mark;
+	ByteMark		mark;
 	int				number;
 	DataBuffer*		data;
 };
@@ -129,8 +134,8 @@ struct CaseInfo
 //
 struct ScopeInfo
 {
-	ByteMark*					mark1;
-	ByteMark*					mark2;
+	ByteMark					mark1;
+	ByteMark					mark2;
 	ScopeType					type;
 	DataBuffer*					buffer1;
 	int							globalVarIndexBase;
@@ -140,8 +145,7 @@ struct ScopeInfo
 	// switch-related stuff
 	List<CaseInfo>::Iterator	casecursor;
 	List<CaseInfo>				cases;
-	List<Variable*>				localVariables;
-	List<Variable*>				globalVariables;
+	List<Variable*>				variables;
 	List<Variable*>				globalArrays;
 };
 
@@ -158,7 +162,7 @@ class BotscriptParser
 			SCOPE_Reset,
 		};
 
-		BotscriptParser();
+		BotscriptParser (CompilerContext* context);
 		~BotscriptParser();
 		void					parseBotscript (String fileName);
 		DataBuffer*				parseCommand (CommandInfo* comm);
@@ -166,15 +170,17 @@ class BotscriptParser
 		AssignmentOperator		parseAssignmentOperator();
 		String					parseFloat();
 		void					pushScope (EReset reset = SCOPE_Reset);
+		void					popScope();
 		DataBuffer*				parseStatement();
-		void					addSwitchCase (DataBuffer* b);
+		void					addSwitchCase (ByteMark casemark);
 		void					checkToplevel();
 		void					checkNotToplevel();
 		bool					tokenIs (ETokenType a);
 		String					getTokenString();
 		String					describePosition() const;
 		void					writeToFile (String outfile);
-		Variable*				findVariable (const String& name);
+		void					writeModule (String outfile);
+		Variable*				findVariable (int nameid, StringView name);
 		bool					isInGlobalState() const;
 		void					suggestHighestVarIndex (bool global, int index);
 		int						getHighestVarIndex (bool global);
@@ -194,7 +200,20 @@ class BotscriptParser
 			return m_numStates;
 		}
 
+		inline Lexer* lexer() const
+		{
+			return m_lexer;
+		}
+
+		inline CompilerContext* context() const
+		{
+			return m_context;
+		}
+
 	private:
+		// The compilation this parser is part of
+		CompilerContext*	m_context;
+
 		// The main buffer - the contents of this is what we
 		// write to file after parsing is complete
 		DataBuffer*		m_mainBuffer;
@@ -224,15 +243,34 @@ class BotscriptParser
 		int				m_highestStateVarIndex;
 		int				m_numWrittenBytes;
 		List<ScopeInfo>	m_scopeStack;
+
+		// The innermost visible variable for each name id, indexed by the id.
+		// Variables that share the id are chained through Variable::shadowed.
+		List<Variable*>	m_variablesByName;
+
+		// Commands and events defined before the script, which are not
+		// part of it when it is precompiled
+		int				m_numPredefinedCommands;
+		int				m_numPredefinedEvents;
+
+		// The file each command, event and top-level variable of the script
+		// was declared in, for writeModule. Only kept when read-only.
+		StringList		m_commandSources;
+		StringList		m_eventSources;
+		StringList		m_variableSources;
 		int				m_zandronumVersion;
 		bool			m_defaultZandronumVersion;
 
 		DataBuffer*		currentBuffer();
+		Emitter			emitter();
 		void			parseStateBlock();
 		void			parseEventBlock();
 		void			parseMainloop();
 		void			parseOnEnterExit();
 		void			parseVar();
+		void			parseModule();
+		void			declareVariable (Variable* var);
+		String			fileNameAt (SourceLocation location);
 		void			parseGoto();
 		void			parseIf();
 		void			parseElse();
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <utility>
+
 #define PROPERTY( ACCESS, TYPE, READ, WRITE, WRITETYPE )			\
 	private:														\
 		TYPE m_##READ;												\
@@ -39,11 +41,18 @@
 		}															\
 																	\
 	ACCESS:															\
-		void WRITE( TYPE const& a ) PROPERTY_##WRITETYPE( READ )	\
+		void WRITE( TYPE const& a ) PROPERTY_##WRITETYPE( TYPE, READ, WRITE )
 
-#define PROPERTY_STOCK_WRITE( READ )	\
-		{								\
-			m_##READ = a;				\
+// Stock setters also take temporaries, whose contents they move in instead of
+// copying.
+#define PROPERTY_STOCK_WRITE( TYPE, READ, WRITE )	\
+		{											\
+			m_##READ = a;							\
+		}											\
+													\
+		void WRITE( TYPE&& a )						\
+		{											\
+			m_##READ = std::move( a );				\
 		}
 
-#define PROPERTY_CUSTOM_WRITE( READ ) ;
\ No newline at end of file
+#define PROPERTY_CUSTOM_WRITE( TYPE, READ, WRITE ) ;
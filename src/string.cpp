@@ -282,7 +282,7 @@ double String::toDouble (bool* ok) const
 
 // =============================================================================
 //
-String String::operator+ (const String& data) const
+String String::operator+ (const String& data) const &
 {
 	String newString = *this;
 	newString.append (data);
@@ -291,13 +291,32 @@ String String::operator+ (const String& data) const
 
 // =============================================================================
 //
-String String::operator+ (const char* data) const
+// Appends to a temporary in place instead of copying it, which makes chains
+// like a + b + c cost one string instead of one per operator.
+//
+String String::operator+ (const String& data) &&
+{
+	append (data);
+	return std::move (*this);
+}
+
+// =============================================================================
+//
+String String::operator+ (const char* data) const &
 {
 	String newstr = *this;
 	newstr.append (data);
 	return newstr;
 }
 
+// =============================================================================
+//
+String String::operator+ (const char* data) &&
+{
+	append (data);
+	return std::move (*this);
+}
+
 // =============================================================================
 //
 bool String::isNumeric() const
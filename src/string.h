@@ -31,6 +31,8 @@
 
 #include <deque>
 #include <string>
+#include <cstring>
+#include <utility>
 #include <stdarg.h>
 #include "types.h"
 #include "list.h"
@@ -50,14 +52,20 @@ class String
 		String() {}
 
 		explicit String (char a) :
-			m_string (&a) {}
+			m_string (1, a) {}
 
 		String (const char* data) :
 			m_string (data) {}
 
+		String (const char* data, int length) :
+			m_string (data, length) {}
+
 		String (const StringType& data) :
 			m_string (data) {}
 
+		String (StringType&& data) :
+			m_string (std::move (data)) {}
+
 		void				dump() const;
 		int					compare (const String& other) const;
 		bool				endsWith (const String& other);
@@ -81,8 +89,10 @@ class String
 		void				trim (int n);
 		String				toUppercase() const;
 
-		String				operator+ (const String& data) const;
-		String				operator+ (const char* data) const;
+		String				operator+ (const String& data) const &;
+		String				operator+ (const String& data) &&;
+		String				operator+ (const char* data) const &;
+		String				operator+ (const char* data) &&;
 
 		static String		fromNumber (int a);
 		static String		fromNumber (long a);
@@ -104,7 +114,12 @@ class String
 
 		inline void append (const String& data)
 		{
-			m_string.append (data.chars());
+			m_string.append (data.m_string);
+		}
+
+		inline void append (const char* data, int length)
+		{
+			m_string.append (data, length);
 		}
 
 		inline Iterator begin()
@@ -194,14 +209,21 @@ class String
 
 		// =============================================================================
 		//
-		inline String operator+ (int num) const
+		inline String operator+ (int num) const &
 		{
 			return *this + String::fromNumber (num);
 		}
 
 		// =============================================================================
 		//
-		inline String& operator+= (const String data)
+		inline String operator+ (int num) &&
+		{
+			return std::move (*this) + String::fromNumber (num);
+		}
+
+		// =============================================================================
+		//
+		inline String& operator+= (const String& data)
 		{
 			append (data);
 			return *this;
@@ -224,9 +246,9 @@ class String
 
 		// =============================================================================
 		//
-		inline void prepend (String a)
+		inline void prepend (const String& a)
 		{
-			m_string = (a + m_string).stdString();
+			m_string.insert (0, a.m_string);
 		}
 
 		// =============================================================================
@@ -341,6 +363,82 @@ class String
 		StringType m_string;
 };
 
+// =============================================================================
+//
+// A non-owning reference to a range of characters, e.g. a token inside the
+// source buffer. The characters are not null-terminated and must outlive the
+// view. Converts to String when an owned copy is needed.
+//
+class StringView
+{
+	public:
+		StringView() :
+			m_data (""),
+			m_length (0) {}
+
+		StringView (const char* data, int length) :
+			m_data (data),
+			m_length (length) {}
+
+		explicit StringView (const String& data) :
+			m_data (data.chars()),
+			m_length (data.length()) {}
+
+		inline const char* data() const
+		{
+			return m_data;
+		}
+
+		inline int length() const
+		{
+			return m_length;
+		}
+
+		inline bool isEmpty() const
+		{
+			return m_length == 0;
+		}
+
+		inline String toString() const
+		{
+			return String (m_data, m_length);
+		}
+
+		inline long toLong (bool* ok = nullptr, int base = 10) const
+		{
+			return toString().toLong (ok, base);
+		}
+
+		inline bool operator== (const char* other) const
+		{
+			return strncmp (m_data, other, m_length) == 0 && other[m_length] == '\0';
+		}
+
+		inline bool operator== (const String& other) const
+		{
+			return other.length() == m_length && memcmp (m_data, other.chars(), m_length) == 0;
+		}
+
+		inline bool operator!= (const char* other) const
+		{
+			return operator== (other) == false;
+		}
+
+		inline bool operator!= (const String& other) const
+		{
+			return operator== (other) == false;
+		}
+
+		inline operator String() const
+		{
+			return toString();
+		}
+
+	private:
+		const char*	m_data;
+		int			m_length;
+};
+
 // =============================================================================
 //
 class StringList : public List<String>
@@ -33,50 +33,59 @@
 #include <string.h>
 #include "stringTable.h"
 
-static StringList g_StringTable;
-
-// ============================================================================
-//
-const StringList& getStringTable()
-{
-	return g_StringTable;
-}
-
 // ============================================================================
 //
 // Potentially adds a string to the table and returns the index of it.
 //
-int getStringTableIndex (const String& a)
+int StringTable::getIndex (const String& a)
 {
 	// Find a free slot in the table.
 	int idx;
 
-	for (idx = 0; idx < g_StringTable.size(); idx++)
+	for (idx = 0; idx < m_strings.size(); idx++)
 	{
 		// String is already in the table, thus return it.
-		if (g_StringTable[idx] == a)
+		if (m_strings[idx] == a)
 			return idx;
 	}
 
 	// Must not be too long.
-	if (a.length() >= gMaxStringLength)
-		error ("string `%1` too long (%2 characters, max is %3)\n",
-			   a, a.length(), gMaxStringLength);
+	checkStringLength (a);
 
 	// Check if the table is already full
-	if (g_StringTable.size() == gMaxStringlistSize - 1)
+	if (m_strings.size() == gMaxStringlistSize - 1)
 		error ("too many strings!\n");
 
 	// Now, dump the string into the slot
-	g_StringTable.append (a);
-	return (g_StringTable.size() - 1);
+	m_strings.append (a);
+	return (m_strings.size() - 1);
+}
+
+// ============================================================================
+//
+// Errors out if the given string could not be put in the table, like getIndex
+// would, but only counts the distinct strings instead of storing them in order.
+//
+void StringTable::check (const String& a)
+{
+	if (m_checkedStrings.find (a) != m_checkedStrings.end())
+		return;
+
+	checkStringLength (a);
+
+	if ((int) m_checkedStrings.size() == gMaxStringlistSize - 1)
+		error ("too many strings!\n");
+
+	m_checkedStrings.insert (a);
 }
 
 // ============================================================================
 //
-// Counts the amount of strings in the table.
+// Errors out if the given string is too long to be put in the table.
 //
-int countStringsInTable()
+void checkStringLength (const String& a)
 {
-	return g_StringTable.size();
+	if (a.length() >= gMaxStringLength)
+		error ("string `%1` too long (%2 characters, max is %3)\n",
+			   a, a.length(), gMaxStringLength);
 }
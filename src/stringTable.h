@@ -29,10 +29,38 @@
 #ifndef BOTC_STRINGTABLE_H
 #define BOTC_STRINGTABLE_H
 
+#include <set>
 #include "main.h"
 
-int getStringTableIndex (const String& a);
-const StringList& getStringTable();
-int countStringsInTable();
+// =============================================================================
+//
+// The strings of a script, which are written at the end of its bytecode and
+// referred to by their index.
+//
+// When nothing is emitted, the strings only need to be checked: check() makes
+// sure they would fit in the table, without building it.
+//
+class StringTable
+{
+	public:
+		int		getIndex (const String& a);
+		void	check (const String& a);
+
+		inline const StringList& strings() const
+		{
+			return m_strings;
+		}
+
+		inline int count() const
+		{
+			return m_strings.size();
+		}
+
+	private:
+		StringList			m_strings;
+		std::set<String>	m_checkedStrings;
+};
+
+void checkStringLength (const String& a);
 
 #endif // BOTC_STRINGTABLE_H
@@ -0,0 +1,398 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "tokenCache.h"
+#include "dataReader.h"
+#include "gitinfo.h"
+
+// =============================================================================
+//
+// Starts a cache file. The header is followed by the compiler version, then
+// the token locations, payloads and types, then the unescaped strings and
+// finally the directives. Strings are stored as their length and characters.
+//
+struct TokenCache::Header
+{
+	char		magic[8];
+	uint32_t	formatVersion;
+	uint32_t	numTokens;
+	Key			key;
+	uint32_t	numCopiedTexts;
+	uint32_t	numDirectives;
+};
+
+static const char CacheFileMagic[8] = { 'B', 'O', 'T', 'C', 'T', 'O', 'K', 'S' };
+
+// =============================================================================
+//
+static inline uint64_t rotateLeft (uint64_t a, int n)
+{
+	return (a << n) | (a >> (64 - n));
+}
+
+// =============================================================================
+//
+static inline uint64_t finalizeHash (uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// =============================================================================
+//
+// Hashes @data 16 bytes at a time into two lanes, after MurmurHash3. Source
+// files are hashed on every run, so this has to be much faster than lexing.
+//
+static void hashData (const char* data, long size, uint64_t seed, uint64_t hash[2])
+{
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+	uint64_t a = seed;
+	uint64_t b = seed;
+	long i = 0;
+
+	for (;;)
+	{
+		uint64_t x, y;
+
+		if (size - i >= 16)
+		{
+			memcpy (&x, data + i, sizeof x);
+			memcpy (&y, data + i + 8, sizeof y);
+		}
+		elif (i < size)
+		{
+			char tail[16] = {};
+			memcpy (tail, data + i, size - i);
+			memcpy (&x, tail, sizeof x);
+			memcpy (&y, tail + 8, sizeof y);
+		}
+		else
+			break;
+
+		a ^= rotateLeft (x * c1, 31) * c2;
+		a = (rotateLeft (a, 27) + b) * 5 + 0x52dce729;
+		b ^= rotateLeft (y * c2, 33) * c1;
+		b = (rotateLeft (b, 31) + a) * 5 + 0x38495ab5;
+		i += 16;
+	}
+
+	a ^= size;
+	b ^= size;
+	a += b;
+	b += a;
+	a = finalizeHash (a);
+	b = finalizeHash (b);
+	a += b;
+	b += a;
+	hash[0] = a;
+	hash[1] = b;
+}
+
+// =============================================================================
+//
+// The version of the compiler that wrote the tokens. Cache entries are only
+// used by the very same version.
+//
+static const String& compilerVersion()
+{
+	static const String version = format ("%1 %2 %3 %4", APPNAME, versionString (true),
+		GIT_HASH, GIT_TIME);
+	return version;
+}
+
+// =============================================================================
+//
+TokenCache::Key TokenCache::makeKey (const char* source, long size)
+{
+	const String& version = compilerVersion();
+	uint64_t seed[2];
+	hashData (version.chars(), version.length(), 0, seed);
+
+	Key key;
+	hashData (source, size, seed[0] ^ seed[1], key.hash);
+	key.size = size;
+	return key;
+}
+
+// =============================================================================
+//
+// Finds the directory of the cache and creates it if it does not exist yet.
+// Returns an empty string if there is no place for the cache.
+//
+String TokenCache::cacheDirectory()
+{
+#ifdef _WIN32
+	return "";
+#else
+	static const String directory = []() -> String
+	{
+		String path;
+
+		if (getenv ("BOTC_CACHE_DIR") != null && *getenv ("BOTC_CACHE_DIR") != '\0')
+			path = getenv ("BOTC_CACHE_DIR");
+		elif (getenv ("XDG_CACHE_HOME") != null && *getenv ("XDG_CACHE_HOME") != '\0')
+			path = String (getenv ("XDG_CACHE_HOME")) + "/botc";
+		elif (getenv ("HOME") != null && *getenv ("HOME") != '\0')
+			path = String (getenv ("HOME")) + "/.cache/botc";
+		else
+			return "";
+
+		// Create the directory along with any missing parents
+		for (int i = 1; i <= path.length(); ++i)
+		{
+			if (i == path.length() || path[i] == '/')
+			{
+				String parent = path.mid (0, i);
+
+				if (mkdir (parent, 0755) != 0 && errno != EEXIST)
+					return "";
+			}
+		}
+
+		struct stat st;
+
+		if (stat (path, &st) != 0 || S_ISDIR (st.st_mode) == false)
+			return "";
+
+		return path;
+	}();
+
+	return directory;
+#endif
+}
+
+// =============================================================================
+//
+String TokenCache::entryPath (const Key& key)
+{
+	String directory = cacheDirectory();
+
+	if (directory.isEmpty())
+		return "";
+
+	char name[24];
+	snprintf (name, sizeof name, "%016llx.tok", (unsigned long long) key.hash[0]);
+	return directory + "/" + name;
+}
+
+// =============================================================================
+//
+bool TokenCache::load (const char* source, long size, SourceLocation base, TokenCacheEntry& entry)
+{
+#ifdef _WIN32
+	return false;
+#else
+	Key key = makeKey (source, size);
+	String path = entryPath (key);
+
+	if (path.isEmpty())
+		return false;
+
+	int fd = open (path, O_RDONLY);
+
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+
+	if (fstat (fd, &st) != 0 || st.st_size < (off_t) sizeof (Header))
+	{
+		close (fd);
+		return false;
+	}
+
+	void* data = mmap (null, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	DataReader reader ((const char*) data, st.st_size);
+	Header header;
+	String version;
+	bool isValid = reader.read (&header, sizeof header)
+		&& memcmp (header.magic, CacheFileMagic, sizeof header.magic) == 0
+		&& header.formatVersion == FormatVersion
+		&& memcmp (&header.key, &key, sizeof key) == 0
+		&& reader.readString (version)
+		&& version == compilerVersion()
+		&& header.numTokens <= reader.remaining() / 9;
+
+	if (isValid)
+	{
+		int numTokens = header.numTokens;
+		entry.tokenTypes.resize (numTokens);
+		entry.tokenLocations.resize (numTokens);
+		entry.tokenPayloads.resize (numTokens);
+		reader.read (entry.tokenLocations.data(), numTokens * sizeof (SourceLocation));
+		reader.read (entry.tokenPayloads.data(), numTokens * sizeof (int32_t));
+		reader.read (entry.tokenTypes.data(), numTokens);
+
+		for (uint32_t i = 0; i < header.numCopiedTexts && isValid; ++i)
+		{
+			String text;
+			isValid = reader.readString (text);
+			entry.copiedTexts << text;
+		}
+
+		uint32_t directivesEnd = 0;
+
+		for (uint32_t i = 0; i < header.numDirectives && isValid; ++i)
+		{
+			uint32_t values[2] = { 0, 0 };
+			isValid = reader.read (values, sizeof values)
+				&& values[0] >= directivesEnd
+				&& values[0] <= header.numTokens
+				&& values[1] > 0
+				&& values[1] <= header.numTokens - values[0];
+
+			if (isValid == false)
+				break;
+
+			TokenCacheEntry::Directive directive;
+			directive.tokenIndex = values[0];
+			directive.numTokens = values[1];
+			directivesEnd = values[0] + values[1];
+			entry.directives << directive;
+		}
+
+		// The text of the tokens is looked up from the source, so everything
+		// pointing into it is checked to be within it.
+		for (int i = 0; i < numTokens && isValid; ++i)
+		{
+			SourceLocation offset = entry.tokenLocations[i];
+			int32_t payload = entry.tokenPayloads[i];
+			isValid = entry.tokenTypes[i] < TK_Module && offset <= size;
+
+			if (entry.tokenTypes[i] == TK_String && payload < 0)
+				isValid = isValid && -1 - (long) payload < entry.copiedTexts.size();
+			elif (entry.tokenTypes[i] == TK_String)
+				isValid = isValid && offset + 1 + (long) payload <= size;
+			elif (entry.tokenTypes[i] != TK_Number)
+				isValid = isValid && payload >= 0 && offset + (long) payload <= size;
+
+			entry.tokenLocations[i] = base + offset;
+		}
+	}
+
+	munmap (data, st.st_size);
+
+	if (isValid == false)
+		entry = TokenCacheEntry();
+
+	return isValid;
+#endif
+}
+
+// =============================================================================
+//
+// Writes the entry into a file of its own first and then renames it in place,
+// so that other compilers looking at the cache meanwhile never see half of it.
+//
+void TokenCache::store (const char* source, long size, SourceLocation base,
+	const TokenCacheEntry& entry)
+{
+#ifndef _WIN32
+	Key key = makeKey (source, size);
+	String path = entryPath (key);
+
+	if (path.isEmpty())
+		return;
+
+	std::string data;
+	auto put = [&data] (const void* value, long length)
+	{
+		data.append ((const char*) value, length);
+	};
+
+	auto putString = [&put] (const String& str)
+	{
+		uint32_t length = str.length();
+		put (&length, sizeof length);
+		put (str.chars(), length);
+	};
+
+	Header header;
+	memset (&header, 0, sizeof header);
+	memcpy (header.magic, CacheFileMagic, sizeof header.magic);
+	header.formatVersion = FormatVersion;
+	header.key = key;
+	header.numTokens = entry.tokenTypes.size();
+	header.numCopiedTexts = entry.copiedTexts.size();
+	header.numDirectives = entry.directives.size();
+	put (&header, sizeof header);
+	putString (compilerVersion());
+
+	for (SourceLocation location : entry.tokenLocations)
+	{
+		SourceLocation offset = location - base;
+		put (&offset, sizeof offset);
+	}
+
+	put (entry.tokenPayloads.data(), entry.tokenPayloads.size() * sizeof (int32_t));
+	put (entry.tokenTypes.data(), entry.tokenTypes.size());
+
+	for (const String& text : entry.copiedTexts)
+		putString (text);
+
+	for (const TokenCacheEntry::Directive& directive : entry.directives)
+	{
+		uint32_t values[2] = { (uint32_t) directive.tokenIndex, (uint32_t) directive.numTokens };
+		put (values, sizeof values);
+	}
+
+	static std::atomic<int> numTemporaryFiles (0);
+	String temporaryPath = format ("%1.%2-%3.tmp", path, (int) getpid(), numTemporaryFiles++);
+	FILE* fp = fopen (temporaryPath, "wb");
+
+	if (fp == null)
+		return;
+
+	bool isWritten = fwrite (data.data(), 1, data.size(), fp) == data.size();
+
+	if (fclose (fp) != 0 || isWritten == false || rename (temporaryPath, path) != 0)
+		remove (temporaryPath);
+#endif
+}
@@ -0,0 +1,105 @@
+/*
+	Copyright 2012-2014 Santeri Piippo
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions
+	are met:
+
+	1. Redistributions of source code must retain the above copyright
+	   notice, this list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright
+	   notice, this list of conditions and the following disclaimer in the
+	   documentation and/or other materials provided with the distribution.
+	3. The name of the author may not be used to endorse or promote products
+	   derived from this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+	IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+	NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+	THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+	THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BOTC_TOKEN_CACHE_H
+#define BOTC_TOKEN_CACHE_H
+
+#include <vector>
+#include "main.h"
+
+// =============================================================================
+//
+// The tokens of a single source file, as stored in the token cache. Locations
+// are relative to @base when loaded or stored, and the payloads are as in the
+// lexer's token arrays with the unescaped strings numbered from the file's
+// first one.
+//
+// Preprocessor directives are kept among the tokens, without the '#' that
+// starts them. They are listed in @directives so that they can be told apart
+// from the rest.
+//
+struct TokenCacheEntry
+{
+	struct Directive
+	{
+		int							tokenIndex;
+		int							numTokens;
+	};
+
+	std::vector<uint8_t>			tokenTypes;
+	std::vector<SourceLocation>		tokenLocations;
+	std::vector<int32_t>			tokenPayloads;
+	List<String>					copiedTexts;
+	List<Directive>					directives;
+};
+
+// =============================================================================
+//
+// Token streams of files that have been lexed before, stored on disk keyed by
+// a hash of the file contents and the compiler version. The cache lives in
+// $BOTC_CACHE_DIR, or failing that, $XDG_CACHE_HOME/botc or ~/.cache/botc.
+// Any entry that does not match the source exactly is ignored and failing to
+// access the cache is never an error.
+//
+class TokenCache
+{
+public:
+	// Identifies the contents of a source file: its size and a 128-bit hash
+	// of it, seeded with the compiler version so that a new compiler misses
+	// the entries of old ones.
+	struct Key
+	{
+		uint64_t	hash[2];
+		uint64_t	size;
+	};
+
+	// Looks for the tokens of @source in the cache. Returns false if there
+	// are none.
+	static bool load (const char* source, long size, SourceLocation base, TokenCacheEntry& entry);
+
+	// Adds the tokens of @source to the cache.
+	static void store (const char* source, long size, SourceLocation base,
+		const TokenCacheEntry& entry);
+
+	static Key makeKey (const char* source, long size);
+
+private:
+	// Must be changed whenever the token encoding or the layout of the cache
+	// files does.
+	enum
+	{
+		FormatVersion = 2
+	};
+
+	struct Header;
+
+	static String	cacheDirectory();
+	static String	entryPath (const Key& key);
+};
+
+#endif // BOTC_TOKEN_CACHE_H
@@ -122,6 +122,7 @@ named_enum ETokenType
 	TK_Symbol,
 	TK_Number,
 	TK_String,
+	TK_Module, // an #include of a precompiled module, see module.h
 	TK_Any,
 };
 
@@ -29,6 +29,7 @@
 #ifndef BOTC_TYPES_H
 #define BOTC_TYPES_H
 
+#include <cstdint>
 #include <cstdlib>
 #include <stdexcept>
 #include "macros.h"
@@ -49,19 +50,33 @@ named_enum DataType
 
 // =============================================================================
 //
+// A handle to a mark, a position in the bytecode that references can point to.
+// Marks are kept in the MarkTable of their compilation, see markTable.h. The
+// default handle refers to no mark.
+//
 struct ByteMark
 {
-	String		name;
-	int			pos;
+	int32_t		index;
+
+	ByteMark() :
+		index (-1) {}
+
+	explicit ByteMark (int32_t index) :
+		index (index) {}
+
+	inline bool isValid() const
+	{
+		return index != -1;
+	}
 };
 
 // =============================================================================
 //
-struct MarkReference
-{
-	ByteMark*	target;
-	int			pos;
-};
+// A position in the source code. Every file processed by the lexer is given
+// its own range of locations, so a single 32-bit value identifies both the
+// file and the offset within it. Use Lexer::describeLocation to decode one.
+//
+using SourceLocation = uint32_t;
 
 // =============================================================================
 //